@@ -0,0 +1,457 @@
+/*
+ * libtsh - job control for programs that run child processes
+ *
+ * See libtsh.h. Everything here works on the context it is handed and
+ * keeps no state of its own, so it is safe to use several contexts
+ * side by side.
+ */
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "libtsh.h"
+
+/*****************
+ * Setup
+ *****************/
+
+/* clearjob - Clear the entries in a job struct */
+static void clearjob(struct tsh_job *job)
+{
+    job->pid = 0;
+    job->jid = 0;
+    job->state = TSH_UNDEF;
+    job->pidfd = -1;
+    job->pgid = 0;
+    job->leaderGone = 0;
+    job->descendants = 0;
+    job->cpuUsec = 0;
+    job->memKB = 0;
+    job->cmdline[0] = '\0';
+    job->data = NULL;
+}
+
+/* tsh_init - Start an empty job table with no subscribers or hooks */
+void tsh_init(struct tsh_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        clearjob(&ctx->jobs[i]);
+    ctx->nextjid = 1;
+    ctx->subCount = 0;
+    memset(&ctx->hooks, 0, sizeof(ctx->hooks));
+}
+
+/* tsh_subscribe - Call fn(ctx, job, oldState, arg) on every state change */
+int tsh_subscribe(struct tsh_ctx *ctx, tsh_notify_fn *fn, void *arg)
+{
+    if (ctx->subCount == TSH_MAXSUBS) {
+        errno = ENOSPC;
+        return -1;
+    }
+    ctx->subs[ctx->subCount].fn = fn;
+    ctx->subs[ctx->subCount].arg = arg;
+    ctx->subCount++;
+    return 0;
+}
+
+/* notify - Tell the subscribers that job went from oldState to its state */
+static void notify(struct tsh_ctx *ctx, struct tsh_job *job, int oldState)
+{
+    int i;
+
+    for (i = 0; i < ctx->subCount; i++)
+        ctx->subs[i].fn(ctx, job, oldState, ctx->subs[i].arg);
+}
+
+/*****************
+ * Running jobs
+ *****************/
+
+/*
+ * tsh_spawn - Run path with argv and envp as a new job in state
+ *    TSH_FG or TSH_BG, leading its own process group. The launch hook
+ *    gets the first try; if there is none or it fails, we fork and
+ *    exec. The child starts with no signals blocked. Returns the job,
+ *    or NULL if it could not be started or the table is full.
+ */
+struct tsh_job *tsh_spawn(struct tsh_ctx *ctx, char *path, char **argv, char **envp,
+                          int state, const char *cmdline)
+{
+    sigset_t blockListSet, prevSet, noSignals;
+    struct tsh_job *job;
+    int pidfd = -1;
+    pid_t pid = -1;
+
+    // block SIGCHLD so a handler can't see the child before it is a job
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+
+    if (ctx->hooks.launch) {
+        pid = ctx->hooks.launch(ctx->hooks.arg, path, argv, envp, &pidfd);
+    }
+    if (pid < 0 && (pid = fork()) == 0) {
+        // join our own group here too so we are in it before exec even if the parent runs late
+        setpgid(0, 0);
+        sigemptyset(&noSignals);
+        sigprocmask(SIG_SETMASK, &noSignals, NULL);
+        if (ctx->hooks.beforeExec) {
+            ctx->hooks.beforeExec(ctx->hooks.arg);
+        }
+        execve(path, argv, envp);
+        if (ctx->hooks.execFailed) {
+            ctx->hooks.execFailed(ctx->hooks.arg, path);
+        }
+        _exit(127);
+    }
+    if (pid < 0) {
+        int savedErrno = errno;
+        sigprocmask(SIG_SETMASK, &prevSet, NULL);
+        errno = savedErrno;
+        return NULL;
+    }
+
+    setpgid(pid, 0);
+    if (!(job = tsh_addjob(ctx, pid, state, cmdline))) {
+        // nowhere to keep it, don't leave it running untracked
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+        sigprocmask(SIG_SETMASK, &prevSet, NULL);
+        errno = ENOSPC;
+        return NULL;
+    }
+    job->pidfd = pidfd;
+    sigprocmask(SIG_SETMASK, &prevSet, NULL);
+    return job;
+}
+
+/*
+ * tsh_update - Apply a wait status of the job's leader: mark it stopped,
+ *    mark a continued job running, or add the usage of a leader that is
+ *    gone and retire the job. Returns the job's new state.
+ */
+int tsh_update(struct tsh_ctx *ctx, struct tsh_job *job, int status, const struct rusage *usage)
+{
+    if (WIFSTOPPED(status)) {
+        tsh_setstate(ctx, job, TSH_ST);
+        return TSH_ST;
+    }
+    if (WIFCONTINUED(status)) {
+        if (job->state == TSH_ST) {
+            tsh_setstate(ctx, job, TSH_BG);
+        }
+        return job->state;
+    }
+    if (usage) {
+        tsh_account(job, job->pid,
+                    (usage->ru_utime.tv_sec + usage->ru_stime.tv_sec) * 1000000L +
+                    usage->ru_utime.tv_usec + usage->ru_stime.tv_usec, usage->ru_maxrss);
+    }
+    return tsh_retire(ctx, job);
+}
+
+/*
+ * tsh_account - Add the CPU time and max RSS of a reaped process of the
+ *    job, its leader or another process of its group, to the job
+ */
+void tsh_account(struct tsh_job *job, pid_t pid, long cpuUsec, long rssKB)
+{
+    if (pid != job->pid) {
+        job->descendants++;
+    }
+    job->cpuUsec += cpuUsec;
+    if (rssKB > job->memKB) {
+        job->memKB = rssKB;
+    }
+}
+
+/*
+ * tsh_retire - The job's leader is gone. The job is deleted if nothing
+ *    else is left in its process group. Otherwise it stays, marked
+ *    leaderGone and out of the foreground, so whoever waits for the
+ *    leader stops waiting. Returns the job's new state.
+ */
+int tsh_retire(struct tsh_ctx *ctx, struct tsh_job *job)
+{
+    if (killpg(job->pgid, 0) == 0) {
+        job->leaderGone = 1;
+        if (job->state == TSH_FG) {
+            tsh_setstate(ctx, job, TSH_BG);
+        }
+        return job->state;
+    }
+    tsh_deletejob(ctx, job->pid);
+    return TSH_UNDEF;
+}
+
+/* tsh_sweep - Retire the leaderless jobs again, returns how many are gone now */
+int tsh_sweep(struct tsh_ctx *ctx)
+{
+    int i, gone = 0;
+
+    for (i = 0; i < TSH_MAXJOBS; i++) {
+        if (ctx->jobs[i].pid != 0 && ctx->jobs[i].leaderGone &&
+            tsh_retire(ctx, &ctx->jobs[i]) == TSH_UNDEF) {
+            gone++;
+        }
+    }
+    return gone;
+}
+
+/*
+ * tsh_wait - Block until the job exits, is killed or stops, and store
+ *    its wait status. The job is deleted unless it stopped.
+ */
+int tsh_wait(struct tsh_ctx *ctx, struct tsh_job *job, int *status)
+{
+    struct rusage usage;
+    int waitStatus;
+    pid_t pid = job->pid;
+
+    if (pid < 1) {
+        errno = ECHILD;
+        return -1;
+    }
+    while (wait4(pid, &waitStatus, WUNTRACED, &usage) < 0) {
+        if (errno != EINTR)
+            return -1;
+    }
+    tsh_update(ctx, job, waitStatus, &usage);
+    if (status) {
+        *status = waitStatus;
+    }
+    return 0;
+}
+
+/*
+ * tsh_reap - Collect whatever happened to the jobs without blocking.
+ *    Only the processes in the jobs' own process groups are waited
+ *    for, so the caller's other children are left alone. Returns how
+ *    many changes were seen.
+ */
+int tsh_reap(struct tsh_ctx *ctx)
+{
+    struct rusage usage;
+    struct tsh_job *job;
+    int i, status, changes = 0;
+    pid_t pid;
+
+    for (i = 0; i < TSH_MAXJOBS; i++) {
+        job = &ctx->jobs[i];
+        while (job->pid != 0 &&
+               (pid = wait4(-job->pgid, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage)) > 0) {
+            if (pid == job->pid) {
+                tsh_update(ctx, job, status, &usage);
+                changes++;
+            }
+            else if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                // one of the job's other processes, a subreaper gets those
+                tsh_account(job, pid, (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L +
+                            usage.ru_utime.tv_usec + usage.ru_stime.tv_usec, usage.ru_maxrss);
+            }
+        }
+    }
+    return changes + tsh_sweep(ctx);
+}
+
+/*
+ * tsh_signal - Send sig to the job's process group. A stopped job also
+ *    gets SIGCONT so it acts on a signal that ends it.
+ */
+int tsh_signal(struct tsh_ctx *ctx, struct tsh_job *job, int sig)
+{
+    (void) ctx;
+    if (killpg(job->pgid, sig) < 0) {
+        return -1;
+    }
+    if (job->state == TSH_ST && sig != SIGSTOP && sig != SIGTSTP && sig != SIGTTIN &&
+        sig != SIGTTOU && sig != SIGCONT) {
+        // a stopped job only acts on the signal once it runs again
+        killpg(job->pgid, SIGCONT);
+    }
+    return 0;
+}
+
+/*
+ * tsh_fg - Make the job the foreground job, continuing it if it is
+ *    stopped. Fails with EBUSY if another job is in the foreground.
+ */
+int tsh_fg(struct tsh_ctx *ctx, struct tsh_job *job)
+{
+    pid_t fgPID = tsh_fgpid(ctx);
+
+    if (fgPID && fgPID != job->pid) {
+        errno = EBUSY;
+        return -1;
+    }
+    if (job->state == TSH_ST && killpg(job->pgid, SIGCONT) < 0) {
+        return -1;
+    }
+    tsh_setstate(ctx, job, TSH_FG);
+    return 0;
+}
+
+/* tsh_bg - Let the job run in the background, continuing it if it is stopped */
+int tsh_bg(struct tsh_ctx *ctx, struct tsh_job *job)
+{
+    if (job->state == TSH_ST && killpg(job->pgid, SIGCONT) < 0) {
+        return -1;
+    }
+    tsh_setstate(ctx, job, TSH_BG);
+    return 0;
+}
+
+/*****************
+ * The job table
+ *****************/
+
+/* tsh_addjob - Add a job started elsewhere to the job table */
+struct tsh_job *tsh_addjob(struct tsh_ctx *ctx, pid_t pid, int state, const char *cmdline)
+{
+    struct tsh_job *job;
+    int i;
+
+    if (pid < 1) {
+        errno = EINVAL;
+        return NULL;
+    }
+    for (i = 0; i < TSH_MAXJOBS; i++) {
+        job = &ctx->jobs[i];
+        if (job->pid == 0) {
+            job->pid = pid;
+            job->pgid = pid;     /* every job leads its own process group */
+            job->state = state;
+            job->jid = ctx->nextjid++;
+            if (ctx->nextjid > TSH_MAXJOBS)
+                ctx->nextjid = 1;
+            strncpy(job->cmdline, cmdline, TSH_MAXLINE - 1);
+            job->cmdline[TSH_MAXLINE - 1] = '\0';
+            notify(ctx, job, TSH_UNDEF);
+            return job;
+        }
+    }
+    errno = ENOSPC;
+    return NULL;
+}
+
+/* tsh_deletejob - Delete the job whose PID=pid from the job table */
+int tsh_deletejob(struct tsh_ctx *ctx, pid_t pid)
+{
+    struct tsh_job *job = tsh_getjobpid(ctx, pid);
+    int oldState;
+
+    if (!job) {
+        errno = ESRCH;
+        return -1;
+    }
+    if (job->pidfd >= 0) {
+        close(job->pidfd);
+        job->pidfd = -1;
+    }
+    oldState = job->state;
+    job->state = TSH_UNDEF;
+    notify(ctx, job, oldState);
+    clearjob(job);
+    ctx->nextjid = tsh_maxjid(ctx) + 1;
+    return 0;
+}
+
+/* tsh_setstate - Change the job's state and tell the subscribers */
+void tsh_setstate(struct tsh_ctx *ctx, struct tsh_job *job, int state)
+{
+    int oldState = job->state;
+
+    if (oldState != state) {
+        job->state = state;
+        notify(ctx, job, oldState);
+    }
+}
+
+/* tsh_list - Store up to max jobs in table order, returns how many */
+int tsh_list(struct tsh_ctx *ctx, struct tsh_job **out, int max)
+{
+    int i, count = 0;
+
+    for (i = 0; i < TSH_MAXJOBS && count < max; i++)
+        if (ctx->jobs[i].pid != 0)
+            out[count++] = &ctx->jobs[i];
+    return count;
+}
+
+/* tsh_maxjid - Returns largest allocated job ID */
+int tsh_maxjid(struct tsh_ctx *ctx)
+{
+    int i, max = 0;
+
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        if (ctx->jobs[i].jid > max)
+            max = ctx->jobs[i].jid;
+    return max;
+}
+
+/* tsh_fgpid - Return PID of current foreground job, 0 if no such job */
+pid_t tsh_fgpid(struct tsh_ctx *ctx)
+{
+    int i;
+
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        if (ctx->jobs[i].state == TSH_FG)
+            return ctx->jobs[i].pid;
+    return 0;
+}
+
+/* tsh_getjobpid - Find a job (by PID) on the job table */
+struct tsh_job *tsh_getjobpid(struct tsh_ctx *ctx, pid_t pid)
+{
+    int i;
+
+    if (pid < 1)
+        return NULL;
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        if (ctx->jobs[i].pid == pid)
+            return &ctx->jobs[i];
+    return NULL;
+}
+
+/* tsh_getjobjid - Find a job (by JID) on the job table */
+struct tsh_job *tsh_getjobjid(struct tsh_ctx *ctx, int jid)
+{
+    int i;
+
+    if (jid < 1)
+        return NULL;
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        if (ctx->jobs[i].jid == jid)
+            return &ctx->jobs[i];
+    return NULL;
+}
+
+/* tsh_getjobpgid - Find a job (by process group) on the job table */
+struct tsh_job *tsh_getjobpgid(struct tsh_ctx *ctx, pid_t pgid)
+{
+    int i;
+
+    if (pgid < 1)
+        return NULL;
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        if (ctx->jobs[i].pid != 0 && ctx->jobs[i].pgid == pgid)
+            return &ctx->jobs[i];
+    return NULL;
+}
+
+/* tsh_pid2jid - Map process ID to job ID, 0 if it is not a job */
+int tsh_pid2jid(struct tsh_ctx *ctx, pid_t pid)
+{
+    struct tsh_job *job = tsh_getjobpid(ctx, pid);
+
+    return job ? job->jid : 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * libtsh - job control for programs that run child processes
+ *
+ * The job table, launcher, reaper and fg/bg/signal logic of tsh as a
+ * library. All state lives in a struct tsh_ctx the caller owns, so a
+ * program can keep several independent job tables. A context must be
+ * used by one thread at a time. Nothing here installs signal
+ * handlers: either call tsh_reap when SIGCHLD arrives (or
+ * periodically), or block in tsh_wait. A caller that reaps by itself
+ * hands each status to tsh_update, or to tsh_account for the other
+ * processes of a job, and calls tsh_sweep now and then.
+ *
+ * A job ends when its whole process group is gone, not just its
+ * leader: once the leader exits the job stays, moved out of the
+ * foreground, until nothing is left in the group. A caller that is a
+ * child subreaper (PR_SET_CHILD_SUBREAPER) gets the orphaned
+ * processes of its jobs; tsh_reap reaps those and adds their usage to
+ * the job.
+ *
+ * Functions that can fail return -1 or NULL and set errno.
+ */
+#ifndef LIBTSH_H
+#define LIBTSH_H
+
+#include <sys/types.h>
+#include <sys/resource.h>
+
+#define TSH_MAXJOBS    16   /* max jobs at any point in time */
+#define TSH_MAXLINE  1024   /* max command line kept per job */
+#define TSH_MAXSUBS     8   /* max state change subscribers */
+
+/* Job states */
+#define TSH_UNDEF 0 /* undefined, or the job is gone */
+#define TSH_FG 1    /* running in foreground */
+#define TSH_BG 2    /* running in background */
+#define TSH_ST 3    /* stopped */
+
+struct tsh_job {            /* A job */
+    pid_t pid;              /* job PID, 0 for a free slot */
+    int jid;                /* job ID [1, 2, ...] */
+    int state;              /* TSH_UNDEF, TSH_FG, TSH_BG or TSH_ST */
+    int pidfd;              /* pidfd from the launch hook, or -1 */
+    pid_t pgid;             /* process group of the whole job */
+    int leaderGone;         /* the leader exited, others in its group run on */
+    int descendants;        /* other processes of the job reaped */
+    long cpuUsec;           /* CPU time of the reaped processes */
+    long memKB;             /* largest max RSS of the reaped processes */
+    char cmdline[TSH_MAXLINE]; /* command line */
+    void *data;             /* the caller's, NULL when the job is added */
+};
+
+struct tsh_ctx;
+
+/*
+ * Called after a job changed state, with job->state the new state.
+ * When a job goes away the state is TSH_UNDEF and the job is cleared
+ * right after the call returns.
+ */
+typedef void tsh_notify_fn(struct tsh_ctx *ctx, struct tsh_job *job, int oldState, void *arg);
+
+struct tsh_hooks {          /* Optional launcher hooks */
+    /* start path instead of fork+exec, return its pid or -1 to fork */
+    pid_t (*launch)(void *arg, char *path, char **argv, char **envp, int *pidfd);
+    /* runs in the forked child right before execve */
+    void (*beforeExec)(void *arg);
+    /* runs in the child when execve failed, the child then _exits 127 */
+    void (*execFailed)(void *arg, const char *path);
+    void *arg;              /* passed to all of them */
+};
+
+struct tsh_ctx {            /* A job table */
+    struct tsh_job jobs[TSH_MAXJOBS]; /* the jobs, in table order */
+    int nextjid;            /* next job ID to allocate */
+    struct {
+        tsh_notify_fn *fn;
+        void *arg;
+    } subs[TSH_MAXSUBS];    /* state change subscribers */
+    int subCount;           /* used entries in subs */
+    struct tsh_hooks hooks; /* launcher hooks, all NULL by default */
+};
+
+/* Setup */
+void tsh_init(struct tsh_ctx *ctx);
+int tsh_subscribe(struct tsh_ctx *ctx, tsh_notify_fn *fn, void *arg);
+
+/* Running jobs */
+struct tsh_job *tsh_spawn(struct tsh_ctx *ctx, char *path, char **argv, char **envp,
+                          int state, const char *cmdline);
+int tsh_wait(struct tsh_ctx *ctx, struct tsh_job *job, int *status);
+int tsh_reap(struct tsh_ctx *ctx);
+int tsh_update(struct tsh_ctx *ctx, struct tsh_job *job, int status, const struct rusage *usage);
+void tsh_account(struct tsh_job *job, pid_t pid, long cpuUsec, long rssKB);
+int tsh_retire(struct tsh_ctx *ctx, struct tsh_job *job);
+int tsh_sweep(struct tsh_ctx *ctx);
+int tsh_signal(struct tsh_ctx *ctx, struct tsh_job *job, int sig);
+int tsh_fg(struct tsh_ctx *ctx, struct tsh_job *job);
+int tsh_bg(struct tsh_ctx *ctx, struct tsh_job *job);
+
+/* The job table */
+struct tsh_job *tsh_addjob(struct tsh_ctx *ctx, pid_t pid, int state, const char *cmdline);
+int tsh_deletejob(struct tsh_ctx *ctx, pid_t pid);
+void tsh_setstate(struct tsh_ctx *ctx, struct tsh_job *job, int state);
+int tsh_list(struct tsh_ctx *ctx, struct tsh_job **out, int max);
+int tsh_maxjid(struct tsh_ctx *ctx);
+pid_t tsh_fgpid(struct tsh_ctx *ctx);
+struct tsh_job *tsh_getjobpid(struct tsh_ctx *ctx, pid_t pid);
+struct tsh_job *tsh_getjobjid(struct tsh_ctx *ctx, int jid);
+struct tsh_job *tsh_getjobpgid(struct tsh_ctx *ctx, pid_t pgid);
+int tsh_pid2jid(struct tsh_ctx *ctx, pid_t pid);
+
+#endif /* LIBTSH_H */
@@ -0,0 +1,343 @@
+/*
+ * libtsh_test - Tests for libtsh
+ *
+ * Runs small jobs through the library and checks the job table, the
+ * wait statuses and the state change notifications. Prints one line
+ * per failed check and exits with the number of failures.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include "libtsh.h"
+
+int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+extern char **environ;
+
+/* Everything the recording subscriber saw */
+struct change_t {
+    pid_t pid;
+    int oldState;
+    int newState;
+};
+struct changes_t {
+    struct change_t seen[64];
+    int count;
+};
+
+/* recordChange - Subscriber that keeps every state change in a changes_t */
+void recordChange(struct tsh_ctx *ctx, struct tsh_job *job, int oldState, void *arg)
+{
+    struct changes_t *changes = arg;
+
+    if (changes->count < 64) {
+        changes->seen[changes->count].pid = job->pid;
+        changes->seen[changes->count].oldState = oldState;
+        changes->seen[changes->count].newState = job->state;
+        changes->count++;
+    }
+}
+
+/* spawnShell - Start "/bin/sh -c script" as a job */
+struct tsh_job *spawnShell(struct tsh_ctx *ctx, const char *script, int state)
+{
+    char *argv[] = { "/bin/sh", "-c", (char *) script, NULL };
+
+    return tsh_spawn(ctx, "/bin/sh", argv, environ, state, script);
+}
+
+/* reapUntil - Call tsh_reap until the job reaches state, give up after 5s */
+int reapUntil(struct tsh_ctx *ctx, pid_t pid, int state)
+{
+    struct timespec pause = { 0, 10000000 };
+    struct tsh_job *job;
+    int i;
+
+    for (i = 0; i < 500; i++) {
+        tsh_reap(ctx);
+        job = tsh_getjobpid(ctx, pid);
+        if ((job ? job->state : TSH_UNDEF) == state)
+            return 1;
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+/*
+ * countUntil - Call tsh_reap until the table holds count jobs, give up
+ *    after 5s. A job stays until its whole process group is gone, and
+ *    a killed shell's own children take a moment longer.
+ */
+int countUntil(struct tsh_ctx *ctx, int count)
+{
+    struct timespec pause = { 0, 10000000 };
+    struct tsh_job *list[TSH_MAXJOBS];
+    int i;
+
+    for (i = 0; i < 500; i++) {
+        tsh_reap(ctx);
+        if (tsh_list(ctx, list, TSH_MAXJOBS) == count)
+            return 1;
+        nanosleep(&pause, NULL);
+    }
+    return 0;
+}
+
+/* testSpawnWait - A foreground job's exit status and its removal */
+void testSpawnWait(void)
+{
+    struct tsh_ctx ctx;
+    struct tsh_job *job;
+    int status = 0;
+
+    tsh_init(&ctx);
+    job = spawnShell(&ctx, "exit 3", TSH_FG);
+    CHECK(job != NULL);
+    if (!job)
+        return;
+    CHECK(job->jid == 1);
+    CHECK(job->pgid == job->pid);
+    CHECK(tsh_fgpid(&ctx) == job->pid);
+    CHECK(strcmp(job->cmdline, "exit 3") == 0);
+    CHECK(tsh_wait(&ctx, job, &status) == 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 3);
+    CHECK(tsh_fgpid(&ctx) == 0);
+    CHECK(tsh_maxjid(&ctx) == 0);
+}
+
+/* testExecFailed - A command that can't be executed exits 127 */
+void testExecFailed(void)
+{
+    char *argv[] = { "/nonexistent/command", NULL };
+    struct tsh_ctx ctx;
+    struct tsh_job *job;
+    int status = 0;
+
+    tsh_init(&ctx);
+    job = tsh_spawn(&ctx, argv[0], argv, environ, TSH_FG, argv[0]);
+    CHECK(job != NULL);
+    if (!job)
+        return;
+    CHECK(tsh_wait(&ctx, job, &status) == 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+}
+
+/* testSignals - Stop, continue and kill a background job through the reaper */
+void testSignals(void)
+{
+    struct changes_t changes = { .count = 0 };
+    struct tsh_ctx ctx;
+    struct tsh_job *job;
+    pid_t pid;
+
+    tsh_init(&ctx);
+    CHECK(tsh_subscribe(&ctx, recordChange, &changes) == 0);
+    job = spawnShell(&ctx, "while :; do sleep 1; done", TSH_BG);
+    CHECK(job != NULL);
+    if (!job)
+        return;
+    pid = job->pid;
+    CHECK(tsh_fgpid(&ctx) == 0);
+
+    CHECK(tsh_signal(&ctx, job, SIGSTOP) == 0);
+    CHECK(reapUntil(&ctx, pid, TSH_ST));
+    CHECK(tsh_bg(&ctx, job) == 0);
+    CHECK(job->state == TSH_BG);
+    CHECK(tsh_signal(&ctx, job, SIGTERM) == 0);
+    CHECK(reapUntil(&ctx, pid, TSH_UNDEF));
+    CHECK(tsh_getjobpid(&ctx, pid) == NULL);
+
+    // added, stopped, continued, gone
+    CHECK(changes.count >= 4);
+    CHECK(changes.seen[0].pid == pid && changes.seen[0].oldState == TSH_UNDEF &&
+          changes.seen[0].newState == TSH_BG);
+    CHECK(changes.seen[1].oldState == TSH_BG && changes.seen[1].newState == TSH_ST);
+    CHECK(changes.seen[2].oldState == TSH_ST && changes.seen[2].newState == TSH_BG);
+    CHECK(changes.seen[changes.count - 1].newState == TSH_UNDEF);
+}
+
+/* testStoppedSignal - A signal that ends a stopped job reaches it */
+void testStoppedSignal(void)
+{
+    struct tsh_ctx ctx;
+    struct tsh_job *job;
+    int status = 0;
+
+    tsh_init(&ctx);
+    job = spawnShell(&ctx, "while :; do sleep 1; done", TSH_FG);
+    CHECK(job != NULL);
+    if (!job)
+        return;
+    CHECK(tsh_signal(&ctx, job, SIGTSTP) == 0);
+    CHECK(tsh_wait(&ctx, job, &status) == 0);
+    CHECK(WIFSTOPPED(status));
+    CHECK(job->state == TSH_ST);
+    CHECK(tsh_signal(&ctx, job, SIGINT) == 0);
+    CHECK(tsh_wait(&ctx, job, &status) == 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGINT);
+}
+
+/* testFgBg - Only one foreground job at a time */
+void testFgBg(void)
+{
+    struct tsh_ctx ctx;
+    struct tsh_job *first, *second;
+    pid_t pid;
+
+    tsh_init(&ctx);
+    first = spawnShell(&ctx, "sleep 5", TSH_BG);
+    second = spawnShell(&ctx, "sleep 5", TSH_BG);
+    CHECK(first != NULL && second != NULL);
+    if (!first || !second)
+        return;
+    CHECK(second->jid == 2);
+    CHECK(tsh_fg(&ctx, first) == 0);
+    CHECK(tsh_fgpid(&ctx) == first->pid);
+    CHECK(tsh_fg(&ctx, second) < 0 && errno == EBUSY);
+    CHECK(tsh_bg(&ctx, first) == 0);
+    CHECK(tsh_fg(&ctx, second) == 0);
+
+    pid = first->pid;
+    tsh_signal(&ctx, first, SIGKILL);
+    tsh_signal(&ctx, second, SIGKILL);
+    CHECK(tsh_wait(&ctx, first, NULL) == 0);
+    CHECK(tsh_wait(&ctx, second, NULL) == 0);
+    CHECK(countUntil(&ctx, 0));
+    CHECK(tsh_getjobpid(&ctx, pid) == NULL);
+}
+
+/* testList - tsh_list returns the jobs in table order */
+void testList(void)
+{
+    struct tsh_job *list[TSH_MAXJOBS];
+    struct tsh_ctx ctx;
+    int i;
+
+    tsh_init(&ctx);
+    for (i = 0; i < 3; i++)
+        CHECK(spawnShell(&ctx, "sleep 5", TSH_BG) != NULL);
+    CHECK(tsh_list(&ctx, list, TSH_MAXJOBS) == 3);
+    CHECK(tsh_list(&ctx, list, 2) == 2);
+    CHECK(tsh_list(&ctx, list, TSH_MAXJOBS) == 3);
+    for (i = 0; i < 3; i++)
+        CHECK(list[i]->jid == i + 1);
+
+    CHECK(tsh_signal(&ctx, list[1], SIGKILL) == 0);
+    CHECK(tsh_wait(&ctx, list[1], NULL) == 0);
+    CHECK(countUntil(&ctx, 2));
+    CHECK(tsh_list(&ctx, list, TSH_MAXJOBS) == 2);
+    CHECK(list[0]->jid == 1 && list[1]->jid == 3);
+
+    for (i = 0; i < 2; i++) {
+        tsh_signal(&ctx, list[i], SIGKILL);
+        tsh_wait(&ctx, list[i], NULL);
+    }
+    CHECK(countUntil(&ctx, 0));
+}
+
+/*
+ * testLeaderGone - A job whose leader exits stays, in the background,
+ *    until the rest of its process group is gone, and as a subreaper
+ *    we reap and count the rest
+ */
+void testLeaderGone(void)
+{
+    struct tsh_ctx ctx;
+    struct tsh_job *job;
+    int status = 0;
+    pid_t pid;
+
+    prctl(PR_SET_CHILD_SUBREAPER, 1);
+    tsh_init(&ctx);
+    job = spawnShell(&ctx, "sleep 0.3 & exit 4", TSH_FG);
+    CHECK(job != NULL);
+    if (!job)
+        return;
+    pid = job->pid;
+    CHECK(tsh_wait(&ctx, job, &status) == 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 4);
+    CHECK(tsh_getjobpid(&ctx, pid) == job);
+    CHECK(job->leaderGone && job->state == TSH_BG);
+    CHECK(tsh_fgpid(&ctx) == 0);
+    CHECK(reapUntil(&ctx, pid, TSH_UNDEF));
+    prctl(PR_SET_CHILD_SUBREAPER, 0);
+}
+
+/* testFullTable - A full table refuses new jobs and leaves nothing running */
+void testFullTable(void)
+{
+    struct tsh_job *list[TSH_MAXJOBS];
+    struct tsh_ctx ctx;
+    int i, count;
+
+    tsh_init(&ctx);
+    for (i = 0; i < TSH_MAXJOBS; i++)
+        CHECK(spawnShell(&ctx, "sleep 5", TSH_BG) != NULL);
+    errno = 0;
+    CHECK(spawnShell(&ctx, "sleep 5", TSH_BG) == NULL);
+    CHECK(errno == ENOSPC);
+    CHECK(waitpid(-1, NULL, WNOHANG) == 0);
+
+    count = tsh_list(&ctx, list, TSH_MAXJOBS);
+    CHECK(count == TSH_MAXJOBS);
+    for (i = 0; i < count; i++) {
+        tsh_signal(&ctx, list[i], SIGKILL);
+        tsh_wait(&ctx, list[i], NULL);
+    }
+}
+
+/* testContexts - Two contexts keep separate tables and job IDs */
+void testContexts(void)
+{
+    struct changes_t changesA = { .count = 0 }, changesB = { .count = 0 };
+    struct tsh_ctx a, b;
+    struct tsh_job *jobA, *jobB;
+
+    tsh_init(&a);
+    tsh_init(&b);
+    tsh_subscribe(&a, recordChange, &changesA);
+    tsh_subscribe(&b, recordChange, &changesB);
+    jobA = spawnShell(&a, "exit 1", TSH_FG);
+    jobB = spawnShell(&b, "exit 2", TSH_FG);
+    CHECK(jobA != NULL && jobB != NULL);
+    if (!jobA || !jobB)
+        return;
+    CHECK(jobA->jid == 1 && jobB->jid == 1);
+    CHECK(tsh_getjobpid(&a, jobB->pid) == NULL);
+    CHECK(tsh_getjobpid(&b, jobA->pid) == NULL);
+    CHECK(tsh_getjobpid(&b, jobB->pid) == jobB);
+
+    CHECK(tsh_wait(&a, jobA, NULL) == 0);
+    CHECK(tsh_wait(&b, jobB, NULL) == 0);
+    CHECK(changesA.count == 2 && changesB.count == 2);
+    CHECK(changesA.seen[0].pid != changesB.seen[0].pid);
+}
+
+int main(void)
+{
+    testSpawnWait();
+    testExecFailed();
+    testSignals();
+    testStoppedSignal();
+    testFgBg();
+    testList();
+    testLeaderGone();
+    testFullTable();
+    testContexts();
+
+    printf("libtsh_test: %s (%d failed checks)\n", failures ? "FAIL" : "PASS", failures);
+    return failures;
+}
@@ -0,0 +1,45 @@
+/* 
+ * mycpu.c - A CPU load generator for benchmarking your tiny shell
+ * 
+ * usage: mycpu <ms>
+ * Burns <ms> milliseconds of CPU time in a busy loop, then reports
+ * the wall clock and CPU time it took on stderr.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double msec(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv) 
+{
+    double ms, wallStart, cpuStart, cpu;
+    volatile unsigned long spins = 0;
+    int i;
+
+    if (argc != 2) {
+	fprintf(stderr, "Usage: %s <ms>\n", argv[0]);
+	exit(0);
+    }
+    ms = atof(argv[1]);
+
+    wallStart = msec(CLOCK_MONOTONIC);
+    cpuStart = msec(CLOCK_PROCESS_CPUTIME_ID);
+    /* count CPU time, not wall time, so a busy machine still gets <ms> of work */
+    do {
+	for (i = 0; i < 10000; i++)
+	    spins++;
+	cpu = msec(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    } while (cpu < ms);
+
+    fprintf(stderr, "mycpu: %.3f ms cpu in %.3f ms wall\n",
+	    cpu, msec(CLOCK_MONOTONIC) - wallStart);
+    exit(0);
+}
@@ -0,0 +1,69 @@
+/* 
+ * myio.c - An output load generator for benchmarking your tiny shell
+ * 
+ * usage: myio <mb> [mb/s]
+ * Writes <mb> megabytes to stdout in 64 KB chunks, paced to [mb/s]
+ * megabytes per second if given, as fast as possible otherwise, and
+ * reports the elapsed time and throughput on stderr.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#define CHUNK (64 * 1024)
+
+static double msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv) 
+{
+    static char buf[CHUNK];
+    double rate = 0, start, elapsed, ahead;
+    size_t total, done = 0;
+    ssize_t n;
+    struct timespec pause;
+
+    if (argc != 2 && argc != 3) {
+	fprintf(stderr, "Usage: %s <mb> [mb/s]\n", argv[0]);
+	exit(0);
+    }
+    total = (size_t)atol(argv[1]) << 20;
+    if (argc == 3)
+	rate = atof(argv[2]);
+    memset(buf, 'x', CHUNK);
+    buf[CHUNK - 1] = '\n';
+
+    start = msec();
+    while (done < total) {
+	n = write(STDOUT_FILENO, buf, total - done < CHUNK ? total - done : CHUNK);
+	if (n < 0) {
+	    if (errno == EINTR)
+		continue;
+	    perror("myio: write");
+	    exit(1);
+	}
+	done += n;
+	if (rate > 0) {
+	    /* sleep off however far we are ahead of the requested rate */
+	    ahead = done / (rate * 1048576.0) * 1000.0 - (msec() - start);
+	    if (ahead > 0) {
+		pause.tv_sec = (time_t)(ahead / 1000);
+		pause.tv_nsec = (long)((ahead - pause.tv_sec * 1000.0) * 1000000);
+		nanosleep(&pause, NULL);
+	    }
+	}
+    }
+    elapsed = msec() - start;
+
+    fprintf(stderr, "myio: %zu MB in %.3f ms (%.1f MB/s)\n", total >> 20, elapsed,
+	    elapsed > 0 ? (total / 1048576.0) / (elapsed / 1000.0) : 0.0);
+    exit(0);
+}
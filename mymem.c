@@ -0,0 +1,54 @@
+/* 
+ * mymem.c - A memory load generator for benchmarking your tiny shell
+ * 
+ * usage: mymem <mb> [ms]
+ * Allocates <mb> megabytes, writes to every page so it is really
+ * resident, holds it for [ms] milliseconds (default 0) and reports the
+ * time it took to fault the memory in on stderr.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char **argv) 
+{
+    double start, touched;
+    long pageSize = sysconf(_SC_PAGESIZE);
+    size_t bytes, i;
+    struct timespec hold;
+    char *mem;
+
+    if (argc != 2 && argc != 3) {
+	fprintf(stderr, "Usage: %s <mb> [ms]\n", argv[0]);
+	exit(0);
+    }
+    bytes = (size_t)atol(argv[1]) << 20;
+
+    start = msec();
+    if ((mem = malloc(bytes)) == NULL) {
+	fprintf(stderr, "mymem: can't allocate %s MB\n", argv[1]);
+	exit(1);
+    }
+    for (i = 0; i < bytes; i += pageSize)
+	mem[i] = (char)i;
+    touched = msec();
+    fprintf(stderr, "mymem: %zu MB resident in %.3f ms\n", bytes >> 20, touched - start);
+
+    if (argc == 3) {
+	long ms = atol(argv[2]);
+	hold.tv_sec = ms / 1000;
+	hold.tv_nsec = (ms % 1000) * 1000000;
+	nanosleep(&hold, NULL);
+    }
+    free(mem);
+    exit(0);
+}
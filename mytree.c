@@ -0,0 +1,78 @@
+/* 
+ * mytree.c - A process tree generator for benchmarking your tiny shell
+ * 
+ * usage: mytree <depth> [fanout] [ms]
+ * Forks a tree <depth> levels deep where every inner process has
+ * [fanout] children (default 2) and every leaf sleeps [ms] milliseconds
+ * (default 0). Each parent waits for its children. The root reports the
+ * number of processes and the elapsed time on stderr.
+ */
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+static double msec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* grow - make this process the root of a subtree depth levels deep */
+static void grow(int depth, int fanout, long ms)
+{
+    struct timespec pause;
+    int i;
+
+    if (depth == 0) {
+	pause.tv_sec = ms / 1000;
+	pause.tv_nsec = (ms % 1000) * 1000000;
+	nanosleep(&pause, NULL);
+	return;
+    }
+    for (i = 0; i < fanout; i++) {
+	pid_t pid = fork();
+	if (pid == 0) { /* child */
+	    grow(depth - 1, fanout, ms);
+	    exit(0);
+	}
+	if (pid < 0) {
+	    perror("mytree: fork");
+	    break;
+	}
+    }
+    /* parent waits for its children to terminate */
+    while (wait(NULL) > 0)
+	;
+}
+
+int main(int argc, char **argv) 
+{
+    int depth, fanout = 2, i;
+    long ms = 0, procs = 1, level = 1;
+    double start;
+
+    if (argc < 2 || argc > 4) {
+	fprintf(stderr, "Usage: %s <depth> [fanout] [ms]\n", argv[0]);
+	exit(0);
+    }
+    depth = atoi(argv[1]);
+    if (argc > 2)
+	fanout = atoi(argv[2]);
+    if (argc > 3)
+	ms = atol(argv[3]);
+    for (i = 0; i < depth; i++) {
+	level *= fanout;
+	procs += level;
+    }
+
+    start = msec();
+    grow(depth, fanout, ms);
+    fprintf(stderr, "mytree: %ld processes, depth %d, in %.3f ms\n",
+	    procs, depth, msec() - start);
+    exit(0);
+}
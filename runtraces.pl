@@ -0,0 +1,208 @@
+#!/usr/bin/perl
+use Getopt::Std;
+use POSIX qw(setsid :sys_wait_h);
+use File::Temp qw(tempdir);
+use Time::HiRes qw(time);
+
+#######################################################################
+# runtraces.pl - Parallel regression runner for the trace suite
+#
+# Runs every trace file through sdriver.pl twice, once against the
+# shell under test and once against the reference shell, with all of
+# the driver instances running concurrently. The two outputs of each
+# trace are normalized and compared, and a pass/fail summary is
+# printed. The whole suite takes about as long as its longest trace.
+#
+# A trace for a feature the reference shell does not have comes with
+# a traceNN.expect file next to it, the expected driver output. Such
+# a trace is only run against the shell under test and compared with
+# that file.
+#
+# Normalization:
+#     - Process IDs "(1234)" are renumbered in order of first
+#       appearance, so "(PID1)" in one output matches "(PID1)" in
+#       the other.
+#     - Job IDs "[3]" and "%3" are renumbered the same way.
+#     - /bin/ps rows are reduced to their STAT and COMMAND columns
+#       and only the rows of the trace helper programs are kept.
+#     - Elapsed times like "0.004s" become "N.NNNs".
+#
+# Each driver runs in its own session without a controlling terminal,
+# so terminal signals of one trace never reach another. The driver
+# runs the traces' "/bin/ps a" as a listing of its session, which holds
+# exactly the processes of that trace.
+#
+######################################################################
+
+#
+# usage - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-hv] [-s <shell>] [-r <refshell>] [-a <args>] [-j <n>] [trace ...]\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h            Print this message\n";
+    printf STDERR "  -v            Print a diff for every failing trace\n";
+    printf STDERR "  -s <shell>    Shell program to test (default ./tsh)\n";
+    printf STDERR "  -r <shell>    Reference shell program (default ./tshref)\n";
+    printf STDERR "  -a <args>     Shell arguments (default \"-p\")\n";
+    printf STDERR "  -j <n>        Run at most <n> drivers at once (default: all)\n";
+    die "\n" ;
+}
+
+# Parse the command line arguments
+getopts('hvs:r:a:j:');
+if ($opt_h) {
+    usage();
+}
+$verbose = $opt_v;
+$shellprog = $opt_s ? $opt_s : "./tsh";
+$refprog = $opt_r ? $opt_r : "./tshref";
+$shellargs = defined($opt_a) ? $opt_a : "-p";
+$maxrunning = $opt_j ? $opt_j : 0;
+$driver = "./sdriver.pl";
+
+@traces = @ARGV ? @ARGV : sort glob("trace*.txt");
+@traces
+    or usage("No trace files found");
+
+foreach $prog ($shellprog, $refprog) {
+    -x $prog
+	or die "$0: ERROR: $prog not found or not executable\n";
+}
+foreach $trace (@traces) {
+    -r $trace
+	or die "$0: ERROR: $trace not found or not readable\n";
+}
+
+$tmpdir = tempdir("runtraces.XXXXXX", TMPDIR => 1, CLEANUP => 1);
+
+#
+# Build the list of driver runs: one per (trace, shell) pair, where the
+# reference run of a trace with an .expect file is that file
+#
+@runs = ();
+@pending = ();
+foreach $trace (@traces) {
+    ($name = $trace) =~ s/\.txt$//;
+    $name =~ s/.*\///;
+    ($expect = $trace) =~ s/\.txt$/.expect/;
+    push @runs, { trace => $trace, name => $name, which => "tsh",
+		  prog => $shellprog, out => "$tmpdir/$name.tsh" };
+    push @pending, $runs[-1];
+    if (-r $expect) {
+	push @runs, { trace => $trace, name => $name, which => "ref",
+		      prog => $expect, out => $expect, status => 0, elapsed => 0 };
+    }
+    else {
+	push @runs, { trace => $trace, name => $name, which => "ref",
+		      prog => $refprog, out => "$tmpdir/$name.ref" };
+	push @pending, $runs[-1];
+    }
+}
+
+#
+# start_run - fork a driver for one run with its output sent to a file
+#
+sub start_run
+{
+    my ($run) = @_;
+    my $pid = fork();
+
+    defined($pid)
+	or die "$0: ERROR: fork failed: $!\n";
+    if ($pid == 0) {
+	setsid();
+	open STDOUT, ">", $run->{out}
+	    or die "$0: ERROR: Couldn't open $run->{out}: $!\n";
+	open STDERR, ">&STDOUT";
+	exec $driver, "-t", $run->{trace}, "-s", $run->{prog},
+	    "-a", $shellargs;
+	die "$0: ERROR: Couldn't exec $driver: $!\n";
+    }
+    $run->{start} = time();
+    return $pid;
+}
+
+#
+# Start drivers up to the concurrency limit and reap them as they finish
+#
+$starttime = time();
+%running = ();
+while (@pending || %running) {
+    while (@pending && (!$maxrunning || keys(%running) < $maxrunning)) {
+	$run = shift @pending;
+	$running{start_run($run)} = $run;
+    }
+    $pid = wait();
+    last if $pid < 0;
+    if ($run = delete $running{$pid}) {
+	$run->{status} = $?;
+	$run->{elapsed} = time() - $run->{start};
+    }
+}
+
+#
+# normalize - read a driver output file and return its normalized lines
+#
+sub normalize
+{
+    my ($file) = @_;
+    my (%pids, %jids, @lines);
+
+    open OUT, $file
+	or return ();
+    while (<OUT>) {
+	# /bin/ps rows: keep STAT and COMMAND of the helper programs
+	if (/^\s*\d+\s+\S+\s+(\S+)\s+\d+:\d+\s+(.*)$/) {
+	    my ($stat, $cmd) = ($1, $2);
+	    next unless $cmd =~ /^\.\/my/;
+	    $_ = "$stat $cmd\n";
+	}
+	s/\((\d+)\)/"(PID" . ($pids{$1} ||= keys(%pids) + 1) . ")"/ge;
+	s/\[(\d+)\]/"[JID" . ($jids{$1} ||= keys(%jids) + 1) . "]"/ge;
+	s/%(\d+)/"%JID" . ($jids{$1} ||= keys(%jids) + 1)/ge;
+	s/\b\d+\.\d+s\b/N.NNNs/g;
+	push @lines, $_;
+    }
+    close OUT;
+    return @lines;
+}
+
+#
+# Compare the normalized outputs of each trace and print the summary
+#
+$passed = 0;
+for ($i = 0; $i < @runs; $i += 2) {
+    ($tsh, $ref) = @runs[$i, $i + 1];
+    @tshlines = normalize($tsh->{out});
+    @reflines = normalize($ref->{out});
+
+    if ($tsh->{status} || $ref->{status}) {
+	$result = "ERROR";
+    }
+    elsif (join("", @tshlines) eq join("", @reflines)) {
+	$result = "PASS";
+	$passed++;
+    }
+    else {
+	$result = "FAIL";
+    }
+    printf "%-10s %-5s (%.1fs)\n", $tsh->{name}, $result,
+	$tsh->{elapsed} > $ref->{elapsed} ? $tsh->{elapsed} : $ref->{elapsed};
+
+    if ($verbose && $result ne "PASS") {
+	open NORM, ">", "$tmpdir/$tsh->{name}.tsh.norm"; print NORM @tshlines; close NORM;
+	open NORM, ">", "$tmpdir/$ref->{name}.ref.norm"; print NORM @reflines; close NORM;
+	system("diff", "-u", "--label", $ref->{prog}, "--label", "$shellprog",
+	       "$tmpdir/$ref->{name}.ref.norm", "$tmpdir/$tsh->{name}.tsh.norm");
+	if ($result eq "ERROR") {
+	    print "driver exit status: $shellprog=$tsh->{status} $ref->{prog}=$ref->{status}\n";
+	}
+    }
+}
+printf "%d/%d traces passed in %.1fs\n", $passed, scalar(@traces),
+    time() - $starttime;
+
+exit($passed == @traces ? 0 : 1);
@@ -3,6 +3,8 @@
 use Getopt::Std;
 use FileHandle;
 use IPC::Open2;
+use IO::Select;
+use Time::HiRes qw(time sleep);
 
 #######################################################################
 # sdriver.pl - Shell driver
@@ -32,7 +34,23 @@ use IPC::Open2;
 #     KILL        Send a SIGKILL signal to the child
 #     CLOSE       Close Writer (sends EOF signal to child)
 #     WAIT        Wait() for child to terminate
-#     SLEEP <n>   Sleep for <n> seconds
+#     SLEEP <n>   Sleep for <n> seconds, fractions like 0.25 are allowed
+#     WAITFOR <n> <regex>
+#                 Wait until the shell's output since the last WAITFOR
+#                 matches <regex>, for at most <n> seconds. Everything
+#                 after <n> is the regex, digits and spaces included
+#
+# A "/bin/ps a" shell command lists the processes of the driver's own
+# session instead, in the same columns. "ps a" goes by terminal, so it
+# sees nothing when the driver has none and every trace's processes
+# when several drivers share one.
+#
+# The child's output is read while the trace runs so it can be timed,
+# but by default it is still printed after the trace, as it always was.
+# With -T every line sent, signal and line read is printed as it
+# happens, with the time since the shell started. With -l each INT and
+# TSTP waits (up to a second) for the shell's "... by signal" message,
+# and a table of signal-to-notification latencies ends the output.
 # 
 ######################################################################
 
@@ -42,7 +60,7 @@ use IPC::Open2;
 sub usage 
 {
     printf STDERR "$_[0]\n";
-    printf STDERR "Usage: $0 [-hv] -t <trace> -s <shellprog> -a <args>\n";
+    printf STDERR "Usage: $0 [-hvTl] -t <trace> -s <shellprog> -a <args>\n";
     printf STDERR "Options:\n";
     printf STDERR "  -h            Print this message\n";
     printf STDERR "  -v            Be more verbose\n";
@@ -50,11 +68,13 @@ sub usage
     printf STDERR "  -s <shell>    Shell program to test\n";
     printf STDERR "  -a <args>     Shell arguments\n";
     printf STDERR "  -g            Generate output for autograder\n";
+    printf STDERR "  -T            Print timestamped lines as they are sent and read\n";
+    printf STDERR "  -l            Report INT/TSTP to notification latencies\n";
     die "\n" ;
 }
 
 # Parse the command line arguments
-getopts('hgvt:s:a:');
+getopts('hgvTlt:s:a:');
 if ($opt_h) {
     usage();
 }
@@ -69,6 +89,8 @@ $infile = $opt_t;
 $shellprog = $opt_s;
 $shellargs = $opt_a;
 $grade = $opt_g;
+$timestamps = $opt_T;
+$latency = $opt_l;
 
 # Make sure the input script exists and is readable
 -e $infile
@@ -95,6 +117,110 @@ open INFILE, $infile
 #
 $pid = open2(\*Reader, \*Writer, "$shellprog $shellargs");
 Writer->autoflush();
+$starttime = time();
+$selector = IO::Select->new(\*Reader);
+
+#
+# The child's output as read so far. $output holds all of it, $partial
+# the last line until its newline arrives, $waitpos how far WAITFOR has
+# matched and @latencies one [signal, trace line, seconds] per signal.
+#
+$output = "";
+$partial = "";
+$waitpos = 0;
+$readereof = 0;
+@latencies = ();
+$pendingsignal = undef;
+
+#
+# stamp - time since the shell started, for -T lines
+#
+sub stamp
+{
+    return sprintf("[%9.3f]", time() - $starttime);
+}
+
+#
+# pump - read whatever the child has written, waiting at most $_[0]
+#     seconds for the first bytes. Returns 0 if nothing came in time or
+#     once the child closed its end of the pipe.
+#
+sub pump
+{
+    my ($timeout) = @_;
+    my ($buf, $n, $now);
+
+    return 0 if $readereof;
+    $timeout = 0 if $timeout < 0;
+    return 0 unless $selector->can_read($timeout);
+    $n = sysread(Reader, $buf, 65536);
+    $now = time();
+    if (!$n) {
+	$readereof = 1;
+	print stamp() . " < $partial\n" if $timestamps && $partial ne "";
+	return 0;
+    }
+    $output .= $buf;
+    $partial .= $buf;
+    while ($partial =~ s/^(.*\n)//) {
+	my $line = $1;
+	print stamp() . " < $line" if $timestamps;
+	if ($pendingsignal && $line =~ /by signal \d+/) {
+	    $pendingsignal->[2] = $now - $pendingsignal->[2];
+	    push @latencies, $pendingsignal;
+	    $pendingsignal = undef;
+	}
+    }
+    return 1;
+}
+
+#
+# session - the driver's session ID, which the shell and its jobs share
+#
+sub session
+{
+    if (!defined($sid)) {
+	chomp($sid = `ps -o sid= -p $$`);
+	$sid =~ s/\s//g;
+    }
+    return $sid;
+}
+
+#
+# pumpuntil - keep reading the child's output until time $_[0]
+#
+sub pumpuntil
+{
+    my ($deadline) = @_;
+
+    while (!$readereof && (my $left = $deadline - time()) > 0) {
+	pump($left);
+    }
+}
+
+#
+# sendsignal - send a signal to the child, timing the notification for -l
+#
+sub sendsignal
+{
+    my ($sig) = @_;
+
+    if ($pendingsignal) {
+	# the last one never got a notification
+	$pendingsignal->[2] = undef;
+	push @latencies, $pendingsignal;
+	$pendingsignal = undef;
+    }
+    print stamp() . " ! $sig\n" if $timestamps;
+    kill $sig, $pid;
+    if ($latency && ($sig eq 'INT' || $sig eq 'TSTP')) {
+	$pendingsignal = [$sig, $., time()];
+	my $deadline = time() + 1;
+	while ($pendingsignal && !$readereof && time() < $deadline) {
+	    pump($deadline - time());
+	}
+    }
+}
 
 # The autograder will want to know the child shell's pid
 if ($grade) {
@@ -108,11 +234,35 @@ while (<INFILE>) {
     $line = $_;
     chomp($line);
 
+    # Pick up what the shell wrote in the meantime
+    pump(0);
+
     # Comment line
     if ($line =~ /^#/) {  
 	print "$line\n";
     }
 
+    # Wait for the shell's output to match
+    elsif ($line =~ /^WAITFOR\b/) {
+	$line =~ /^WAITFOR\s+(\d*\.?\d+)\s+(.*?)\s*$/
+	    or die "$0: ERROR: WAITFOR needs <n> <regex> at line $.\n";
+	my ($regex, $deadline) = ($2, time() + $1);
+	if ($verbose) {
+	    print "$0: Waiting for /$regex/\n";
+	}
+	while (1) {
+	    if (substr($output, $waitpos) =~ /$regex/) {
+		$waitpos += $+[0];
+		last;
+	    }
+	    if (time() >= $deadline || $readereof) {
+		print STDERR "$0: WAITFOR /$regex/ timed out at line $.\n";
+		last;
+	    }
+	    pump($deadline - time());
+	}
+    }
+
     # Blank line
     elsif ($line =~ /^\s*$/) { 
 	if ($verbose) {
@@ -125,7 +275,7 @@ while (<INFILE>) {
 	if ($verbose) {
 	    print "$0: Sending SIGTSTP signal to process $pid\n";
 	}
-	kill 'TSTP', $pid;
+	sendsignal('TSTP');
     }
 
     # Send SIGINT (ctrl-c)
@@ -133,7 +283,7 @@ while (<INFILE>) {
 	if ($verbose) {
 	    print "$0: Sending SIGINT signal to process $pid\n";
 	}
-	kill 'INT', $pid;
+	sendsignal('INT');
     }
 
     # Send SIGQUIT (whenever we need graceful termination)
@@ -141,7 +291,7 @@ while (<INFILE>) {
 	if ($verbose) {
 	    print "$0: Sending SIGQUIT signal to process $pid\n";
 	}
-	kill 'QUIT', $pid;
+	sendsignal('QUIT');
     }
 
     # Send SIGKILL 
@@ -149,7 +299,7 @@ while (<INFILE>) {
 	if ($verbose) {
 	    print "$0: Sending SIGKILL signal to process $pid\n";
 	}
-	kill 'KILL', $pid;
+	sendsignal('KILL');
     }
 
     # Close pipe (sends EOF notification to child)
@@ -172,18 +322,22 @@ while (<INFILE>) {
     }
 
     # Sleep
-    elsif ($line =~ /SLEEP (\d+)/) {
+    elsif ($line =~ /SLEEP (\d*\.?\d+)/) {
 	if ($verbose) {
 	    print "$0: Sleeping $1 secs\n";
 	}
-	sleep $1;
+	pumpuntil(time() + $1);
     }
 
     # Unknown input
     else {
+	if ($line =~ /^\/bin\/ps a\s*$/) {
+	    $line = "/bin/ps -s " . session() . " -o pid,tty,stat,bsdtime,args";
+	}
 	if ($verbose) {
 	    print "$0: Sending :$line: to child $pid\n";
 	}
+	print stamp() . " > $line\n" if $timestamps;
 	print Writer "$line\n";
     }
 }
@@ -195,10 +349,40 @@ close Writer;
 if ($verbose) {
     print "$0: Reading data from child $pid\n";
 }
-while ($line = <Reader>) {
-    print $line;
+$deadline = time() + 60;
+while (!$readereof && time() < $deadline) {
+    pump($deadline - time());
+}
+if (!$readereof) {
+    print STDERR "$0: shell $pid still has its output open after 60 secs\n";
 }
 close Reader;
+if ($pendingsignal) {
+    $pendingsignal->[2] = undef;
+    push @latencies, $pendingsignal;
+}
+print $output unless $timestamps;
+
+if ($latency) {
+    my ($count, $total, $min, $max) = (0, 0);
+    print "#\n# Signal to notification latency\n";
+    foreach $entry (@latencies) {
+	my ($sig, $lineno, $secs) = @$entry;
+	if (!defined($secs)) {
+	    printf "# %-4s line %-4d  no notification\n", $sig, $lineno;
+	    next;
+	}
+	printf "# %-4s line %-4d  %9.3f ms\n", $sig, $lineno, $secs * 1000;
+	$count++;
+	$total += $secs;
+	$min = $secs if !defined($min) || $secs < $min;
+	$max = $secs if !defined($max) || $secs > $max;
+    }
+    if ($count) {
+	printf "# %d signals: min %.3f ms, avg %.3f ms, max %.3f ms\n",
+	    $count, $min * 1000, $total / $count * 1000, $max * 1000;
+    }
+}
 
 # Finally, parent reaps child
 wait;
@@ -0,0 +1,147 @@
+#!/usr/bin/perl
+use Getopt::Std;
+
+#######################################################################
+# tracejson.pl - Convert a tsh event recorder dump to Chrome trace JSON
+#
+# tsh records timestamped events into a ring and writes it out on
+# SIGUSR1 or, when started with -t <file>, at exit. This script turns
+# such a dump into the Chrome trace event format, which chrome://tracing
+# and ui.perfetto.dev load directly.
+#
+# Every process that recorded something gets its own track: the shell,
+# background list subshells, the fork server's children and the jobs'
+# own exec. Line, parse, spawn and foreground wait records become
+# spans, each job becomes an async span from its spawn to its reap
+# labelled with its pid, and the rest are instant events.
+#
+######################################################################
+
+#
+# usage - print help message and terminate
+#
+sub usage
+{
+    printf STDERR "$_[0]\n";
+    printf STDERR "Usage: $0 [-h] [-o <json>] <dump>\n";
+    printf STDERR "Options:\n";
+    printf STDERR "  -h            Print this message\n";
+    printf STDERR "  -o <json>     Write the JSON here (default: stdout)\n";
+    die "\n" ;
+}
+
+# Parse the command line arguments
+getopts('ho:');
+if ($opt_h || @ARGV != 1) {
+    usage();
+}
+$dump = $ARGV[0];
+
+# Record kinds, see REC_* in tsh.c: name and span phase ("" for instant)
+%kinds = (
+    1  => ["line", "B"],
+    2  => ["line", "E"],
+    3  => ["parse", "B"],
+    4  => ["parse", "E"],
+    5  => ["spawn", "B"],
+    6  => ["spawn", "E"],
+    7  => ["exec", ""],
+    8  => ["signal", ""],
+    9  => ["reap", ""],
+    10 => ["state", ""],
+    11 => ["event", ""],
+    12 => ["wait fg", "B"],
+    13 => ["wait fg", "E"],
+    14 => ["dump", ""],
+);
+@states = ("UNDEF", "FG", "BG", "ST");
+@events = ("none", "child", "int", "tstp");
+
+#
+# Read the header and check it is a dump we understand
+#
+open DUMP, "<", $dump
+    or die "$0: ERROR: Couldn't open $dump: $!\n";
+binmode DUMP;
+read(DUMP, $header, 32) == 32
+    or die "$0: ERROR: $dump is too short\n";
+($magic, $size, $count, $lost, $shell) = unpack("a8 V V Q< V", $header);
+$magic eq "TSHTRACE"
+    or die "$0: ERROR: $dump is not a tsh event recorder dump\n";
+$size == 24
+    or die "$0: ERROR: unexpected record size $size\n";
+if ($lost) {
+    print STDERR "$0: $lost older records were overwritten\n";
+}
+
+#
+# Convert the records. Times are microseconds from the first record.
+#
+@out = ();
+%tracks = ();
+$start = undef;
+while (read(DUMP, $buf, $size) == $size) {
+    my ($ns, $kind, $self, $pid, $arg) = unpack("q< l< l< l< l<", $buf);
+    my $info = $kinds{$kind};
+    next unless $info;
+    my ($name, $ph) = @$info;
+    my %args = ();
+
+    $start = $ns unless defined($start);
+    my $ts = sprintf("%.3f", ($ns - $start) / 1000);
+    $tracks{$self} = 1;
+
+    if ($kind == 1) {
+	$args{bytes} = $arg;
+    }
+    elsif ($kind == 6) {
+	my $via = $arg ? "fork server" : "fork";
+	push @out, qq({"name":"job $pid","cat":"job","ph":"b","id":$pid,"pid":$shell,"tid":$self,"ts":$ts,"args":{"via":"$via"}});
+    }
+    elsif ($kind == 8) {
+	$name = "signal $arg";
+    }
+    elsif ($kind == 9) {
+	$args{pid} = $pid;
+	$args{status} = $arg;
+	push @out, qq({"name":"job $pid","cat":"job","ph":"e","id":$pid,"pid":$shell,"tid":$self,"ts":$ts})
+	    if ($arg & 0xff) != 0x7f;	# not just stopped
+    }
+    elsif ($kind == 10) {
+	$name = "state $states[$arg]";
+	$args{pid} = $pid;
+    }
+    elsif ($kind == 11) {
+	$name = "event $events[$arg]";
+	$args{pid} = $pid if $pid;
+    }
+    elsif ($kind == 12) {
+	$args{pid} = $pid;
+    }
+    elsif ($kind == 14) {
+	$args{records} = $arg;
+    }
+
+    my $json = join(",", map { qq("$_":) . ($args{$_} =~ /^-?\d+$/ ? $args{$_} : qq("$args{$_}")) }
+		    sort keys %args);
+    my $event = qq({"name":"$name","cat":"tsh","ph":") . ($ph ? $ph : "i") .
+	qq(","pid":$shell,"tid":$self,"ts":$ts);
+    $event .= qq(,"s":"t") unless $ph;
+    $event .= qq(,"args":{$json}) if $json ne "" && $ph ne "E";
+    push @out, $event . "}";
+}
+close DUMP;
+
+# Name the tracks
+foreach $tid (sort { $a <=> $b } keys %tracks) {
+    my $label = ($tid == $shell) ? "tsh" : "process $tid";
+    push @out, qq({"name":"thread_name","ph":"M","pid":$shell,"tid":$tid,"args":{"name":"$label"}});
+}
+push @out, qq({"name":"process_name","ph":"M","pid":$shell,"args":{"name":"tsh $shell"}});
+
+if ($opt_o) {
+    open STDOUT, ">", $opt_o
+	or die "$0: ERROR: Couldn't open $opt_o: $!\n";
+}
+print "{\"traceEvents\":[\n", join(",\n", @out), "\n]}\n";
+exit(0);
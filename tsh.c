@@ -1,969 +1,4437 @@
-/*
- * tsh - A tiny shell program with job control
- *
- * Trent Callan
- * SID: 861117907
- *
- * 2017 Copyright Trent Callan
- * This is my unique code written fully by the named above and is not to be used in any other way.
- */
-
-
-////// Just ONE BIG QUESTION should processes left stopped or backgrounded be killed by the shell when it exits or should they be left to other shells.
-// also is sleep before unblocking SIGCHLD in child process necessary?
-#include <stdio.h>
-#include <assert.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <string.h>
-#include <ctype.h>
-#include <signal.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <errno.h>
-
-/* Misc manifest constants */
-#define MAXLINE    1024   /* max line size */
-#define MAXARGS     128   /* max args on a command line */
-#define MAXJOBS      16   /* max jobs at any point in time */
-#define MAXJID    1<<16   /* max job ID */
-#define MYFGGROUPID   7907
-
-/* Job states */
-#define UNDEF 0 /* undefined */
-#define FG 1    /* running in foreground */
-#define BG 2    /* running in background */
-#define ST 3    /* stopped */
-
-
-/*
- * Jobs states: FG (foreground), BG (background), ST (stopped)
- * Job state transitions and enabling actions:
- *     FG -> ST  : ctrl-z
- *     ST -> FG  : fg command
- *     ST -> BG  : bg command
- *     BG -> FG  : fg command
- * At most 1 job can be in the FG state.
- */
-
-// my debug verbose function
-inline int doNothing(char const* format,...){ return 0; };
-
-int (*debugLog)(char const *,...) = &doNothing;
-
-
-
-/* Global variables */
-extern char **environ;      /* defined in libc */
-char prompt[] = "tsh> ";    /* command line prompt (DO NOT CHANGE) */
-int verbose = 0;            /* if true, print additional output */
-int nextjid = 1;            /* next job ID to allocate */
-int nextPGID = 100;         // next process group id to allocate
-char sbuf[MAXLINE];         /* for composing sprintf messages */
-
-struct job_t {              /* The job struct */
-    pid_t pid;              /* job PID */
-    int jid;                /* job ID [1, 2, ...] */
-    int state;              /* UNDEF, BG, FG, or ST */
-    char cmdline[MAXLINE];  /* command line */
-};
-struct job_t jobs[MAXJOBS]; /* The job list */
-/* End global variables */
-
-
-/* Function prototypes */
-
-/*********************************
- * My Changes To Given Functions
- * int parseArgc(const char *cmdline, char **argv);
- * i reused pasreLine and chaged it to return argc
- * int builtin_cmd(char **argv, int argc);
- * i modified this toallow the passing of argc to built in functions
- * void do_bgfg(char **argv,argc);
- * i modified this toallow the passing of argc to bg and fg
- 
- */
-
-
-/* Here are the functions that you will implement */
-void eval(char *cmdline);
-int builtin_cmd(char **argv, int argc);
-void do_bgfg(char **argv, int argc);
-void waitfg(pid_t pid);
-int getNextPGID();
-
-void sigchld_handler(int sig);
-void sigtstp_handler(int sig);
-void sigint_handler(int sig);
-
-// my helper functions
-int parseArgc(const char *cmdline, char **argv);
-int hasDisallowedChars(char* tmp);
-void terminateAllUnexitedJobs(struct job_t* jobs);
-
-/* Here are helper routines that we've provided for you */
-int parseLine(const char *cmdline, char **argv);
-void sigquit_handler(int sig);
-
-void clearjob(struct job_t *job);
-void initjobs(struct job_t *jobs);
-int maxjid(struct job_t *jobs);
-int addjob(struct job_t *jobs, pid_t pid, int state, char *cmdline);
-int deletejob(struct job_t *jobs, pid_t pid);
-pid_t fgpid(struct job_t *jobs);
-struct job_t *getjobpid(struct job_t *jobs, pid_t pid);
-struct job_t *getjobjid(struct job_t *jobs, int jid);
-int pid2jid(pid_t pid);
-void listjobs(struct job_t *jobs);
-
-void usage(void);
-void unix_error(char *msg);
-void app_error(char *msg);
-typedef void handler_t(int);
-handler_t *Signal(int signum, handler_t *handler);
-
-/*
- * main - The shell's main routine
- */
-int main(int argc, char **argv)
-{
-    char c;
-    char cmdline[MAXLINE];
-    int emit_prompt = 1; /* emit prompt (default) */
-    
-    /* Redirect stderr to stdout (so that driver will get all output
-     * on the pipe connected to stdout) */
-    dup2(1, 2);
-    
-    /* Parse the command line */
-    while ((c = getopt(argc, argv, "hvp")) != EOF) {
-        switch (c) {
-            case 'h':             /* print help message */
-                usage();
-                break;
-            case 'v':             /* emit additional diagnostic info */
-                verbose = 1;
-                debugLog = &printf;
-                break;
-            case 'p':             /* don't print a prompt */
-                emit_prompt = 0;  /* handy for automatic testing */
-                break;
-            default:
-                usage();
-        }
-    }
-    
-    /* Install the signal handlers */
-    
-    /* These are the ones you will need to implement */
-    Signal(SIGINT,  sigint_handler);   /* ctrl-c */
-    Signal(SIGTSTP, sigtstp_handler);  /* ctrl-z */
-    Signal(SIGCHLD, sigchld_handler);  /* Terminated or stopped child */
-    
-    /* This one provides a clean way to kill the shell */
-    Signal(SIGQUIT, sigquit_handler);
-    
-    /* Initialize the job list */
-    initjobs(jobs);
-    
-    /* Execute the shell's read/eval loop */
-    while (1) {
-        
-        /* Read command line */
-        if (emit_prompt) {
-            printf("%s", prompt);
-            fflush(stdout);
-        }
-        if ((fgets(cmdline, MAXLINE, stdin) == NULL) && ferror(stdin))
-            app_error("fgets error");
-        // handle empty command line send
-        if (feof(stdin)) { /* End of file (ctrl-d) */
-            fflush(stdout);
-            exit(0);
-        }
-        
-        /* Evaluate the command line */
-        eval(cmdline);
-        fflush(stdout);
-        fflush(stdout);
-    }
-    // removing control never reaches warning
-    //exit(0); /* control never reaches here */
-}
-
-#pragma mark User Implemented Functions
-
-/*
- * eval - Evaluate the command line that the user has just typed in
- *
- * If the user has requested a built-in command (quit, jobs, bg or fg)
- * then execute it immediately. Otherwise, fork a child process and
- * run the job in the context of the child. If the job is running in
- * the foreground, wait for it to terminate and then return.  Note:
- * each child process must have a unique process group ID so that our
- * background children don't receive SIGINT (SIGTSTP) from the kernel
- * when we type ctrl-c (ctrl-z) at the keyboard.
- */
-void eval(char *cmdLine)
-{
-    if (!strcmp("\n", cmdLine)) {
-        debugLog("Command Line is Empty\n");
-        return;
-    }
-    assert(strcmp("\n", cmdLine) && "commandLine must not be empty");
-    
-    debugLog("cmdLine = %s",cmdLine);
-    
-    char* argv[MAXARGS];
-    char* ignoreArgv[MAXARGS];
-    int argc = parseArgc(cmdLine, ignoreArgv);
-    char commandName[MAXLINE];
-    int childPid= 0;
-    int runInBackground = parseLine(cmdLine,argv);
-    strcpy(commandName,argv[0]);
-    // print parsed command to stdout seperated by | ex ls | -v | ./example
-    debugLog("ParsedCommandName = %s\n", commandName);
-    debugLog("Parsed Argument Count = %d\n", argc);
-    
-    if(strcmp("",commandName)){ // strcmp return 0 if equal
-        // check for built in commands
-        if(builtin_cmd(argv, argc)){
-            //printf("%s ran by builtin_cmd not eval\n",commandName);
-        }
-        else{
-            // is process running in the background?
-            
-            // block SIGCHLD to prevent race conditions
-            sigset_t blockListSet;
-            sigemptyset(&blockListSet);
-            sigaddset(&blockListSet, SIGCHLD);
-            sigprocmask(SIG_BLOCK, &blockListSet, NULL);
-            
-            // run process in background and dont hold shell
-            
-            if((childPid = fork()) == 0){
-                // child process
-                char* iterator = commandName;
-                int absPath = 0;
-                
-                // wait for parent pgid change
-                
-                while (*iterator)
-                {
-                    if (strchr("/", *iterator))
-                    {
-                        // command name contains a slash
-                        absPath = 1;
-                    }
-                    
-                    iterator++;
-                }
-                
-                if (!absPath) {
-                    sprintf(commandName, "/bin/%s",argv[0]);
-                }
-                
-                debugLog("Child has pgid %d\n", getpgrp());
-                fflush(stdout);
-                 
-                //sleep(1); // wait for parent to add job to job list before reenabling SIGCHLD to prevent race condition
-                // reenable SIGCHLD due to inheriting of old sigset
-                
-                sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
-                
-                execve(commandName, argv, environ);
-                
-                // this only runs if execve fails
-                printf("%s: Command Not Found\n",commandName);
-                exit(1);
-                
-            }
-            else{
-                // parent process
-                // first give the child process a new group id
-                debugLog("Setting pid %d to pgid %d from old pgid %d\n",childPid,childPid,getpgid(childPid));
-                setpgid(childPid, 0);
-                if (runInBackground) {
-                    addjob(jobs, childPid, BG, cmdLine);
-                    // unblock SIGCHLD
-                    sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
-                    printf("[%d] (%d) %s", pid2jid(childPid), childPid, cmdLine);
-                }
-                else{
-                    addjob(jobs, childPid, FG, cmdLine);
-                    waitfg(childPid);
-                }
-            }
-        }
-    }
-    
-    return;
-}
-/*
- * getNextPGID - Gets the next unique process group id for a a child process
- *
- */
-int getNextPGID(){
-    int tmp = nextPGID;
-    nextPGID = nextPGID + 1;
-    return tmp;
-}
-
-/*
- * parseline - Parse the command line and build the argv array.
- *
- * Characters enclosed in single quotes are treated as a single
- * argument.  Return true if the user has requested a BG job, false if
- * the user has requested a FG job.
- */
-int parseLine(const char *cmdline, char **argv)
-{
-    static char array[MAXLINE]; /* holds local copy of command line */
-    char *buf = array;          /* ptr that traverses command line */
-    char *delim;                /* points to first space delimiter */
-    int argc;                   /* number of args */
-    int bg;                     /* background job? */
-    
-    strcpy(buf, cmdline);
-    buf[strlen(buf)-1] = ' ';  /* replace trailing '\n' with space */
-    while (*buf && (*buf == ' ')) /* ignore leading spaces */
-        buf++;
-    
-    /* Build the argv list */
-    argc = 0;
-    if (*buf == '\'') {
-        buf++;
-        delim = strchr(buf, '\'');
-    }
-    else {
-        delim = strchr(buf, ' ');
-    }
-    
-    while (delim) {
-        argv[argc++] = buf;
-        *delim = '\0';
-        buf = delim + 1;
-        while (*buf && (*buf == ' ')) /* ignore spaces */
-            buf++;
-        
-        if (*buf == '\'') {
-            buf++;
-            delim = strchr(buf, '\'');
-        }
-        else {
-            delim = strchr(buf, ' ');
-        }
-    }
-    argv[argc] = NULL;
-    
-    if (argc == 0){  /* ignore blank line */
-        return 1;
-    }
-    
-    /* should the job run in the background? */
-    if ((bg = (*argv[argc-1] == '&')) != 0) {
-        argv[--argc] = NULL;
-    }
-    return bg;
-}
-
-/*
- * parseArgc - Parse the command line and build the argc.
- *
- * re running parseline but instead returning argc
- */
-int parseArgc(const char *cmdline, char **argv)
-{
-    static char array[MAXLINE]; /* holds local copy of command line */
-    char *buf = array;          /* ptr that traverses command line */
-    char *delim;                /* points to first space delimiter */
-    int argc;                   /* number of args */
-    int bg;                     /* background job? */
-    
-    strcpy(buf, cmdline);
-    buf[strlen(buf)-1] = ' ';  /* replace trailing '\n' with space */
-    while (*buf && (*buf == ' ')) /* ignore leading spaces */
-        buf++;
-    
-    /* Build the argv list */
-    argc = 0;
-    if (*buf == '\'') {
-        buf++;
-        delim = strchr(buf, '\'');
-    }
-    else {
-        delim = strchr(buf, ' ');
-    }
-    
-    while (delim) {
-        argv[argc++] = buf;
-        *delim = '\0';
-        buf = delim + 1;
-        while (*buf && (*buf == ' ')) /* ignore spaces */
-            buf++;
-        
-        if (*buf == '\'') {
-            buf++;
-            delim = strchr(buf, '\'');
-        }
-        else {
-            delim = strchr(buf, ' ');
-        }
-    }
-    argv[argc] = NULL;
-    
-    if (argc == 0){  /* ignore blank line */
-        return 0;
-    }
-    
-    /* should the job run in the background? */
-    if ((bg = (*argv[argc-1] == '&')) != 0) {
-        argv[--argc] = NULL;
-    }
-    return argc;
-}
-
-/*
- * builtin_cmd - If the user has typed a built-in command then execute
- *    it immediately.
- */
-int builtin_cmd(char **argv, int argc)
-{
-    // if it is a bulit in command run it here and return 1
-    // if not retunr 0 to tell eval that it must run it there
-    int ranSomething = 0;
-    if(!strcmp("quit",argv[0])){
-        debugLog(("Running Quit in builtin_cmd\n"));
-        // kill all process in jobs list befre dying
-        terminateAllUnexitedJobs(jobs);
-        exit(0);
-        
-    }
-    else if(!strcmp("bg",argv[0])){
-        debugLog("Ran bg\n");
-        do_bgfg(argv,argc);
-        ranSomething = 1;
-    }
-    else if(!strcmp("fg",argv[0])){
-        debugLog("ran fg\n");
-        do_bgfg(argv,argc);
-        ranSomething = 1;
-    }
-    else if(!strcmp("jobs",argv[0])){
-        listjobs(jobs);
-        ranSomething = 1;
-    }
-    
-    return ranSomething;     /* not a builtin command */
-}
-
-/*
- * do_bgfg - Execute the builtin bg and fg commands
- * #define FG 1
- * #define BG 2
- * #define ST 3
- */
-void do_bgfg(char **argv, int argc)
-{
-    char commandName[MAXLINE];
-    strcpy(commandName, argv[0]);
-    
-    if (argc >= 2) {
-        if(!hasDisallowedChars(argv[1])){
-            debugLog("Correct Argments for %s found.\n", commandName);
-        }
-        else{
-            printf("%s: argument must be a PID or %%jobid\n", commandName);
-            return;
-        }
-    }
-    else{
-        printf("%s command requires PID or %%jobid argument\n", commandName);
-        return;
-    }
-    
-    
-    // have to clean up jid to find first bg %2 to bg 2 if % then its a job id if no % hen its a pid
-    int jidToStateChange;
-    struct job_t* jobToChange;
-    pid_t pidToStateChange;
-    
-    
-    if (argv[1][0] == '%') {
-        // is job
-        int jidToSearchFor =  atoi(argv[1] + 1);
-        jobToChange = getjobjid(jobs, jidToSearchFor);
-        if (!jobToChange) {
-            printf("%s: %s: no such job\n", commandName, argv[1]);
-            return;
-        }
-    }
-    else{
-        // is process
-        pid_t pidToSearchFor =  atoi(argv[1]);
-        
-        jobToChange = getjobpid(jobs, pidToSearchFor);
-        
-        // check if process exists in jobs list
-        if (!jobToChange) {
-            printf("%s: %s: no such process\n", commandName, argv[1]);
-            return;
-        }
-    }
-    assert(jobToChange && "There must be a job to fg/bg");
-    pidToStateChange = jobToChange->pid;
-    jidToStateChange = jobToChange->jid;
-    
-    debugLog("%sing (%d) from previous state %d\n",commandName,jidToStateChange,jobToChange->state);
-    
-    if (!strcmp("fg", commandName)) {
-        // foreground process
-        
-        if (jobToChange->state == ST) {
-            // change fg job to BG state to allow new process to have FG state
-            jobToChange->state = FG;
-            int test = fgpid(jobs);
-            assert((test > 0 ) && "There can only be one FG job");
-            debugLog("[%d] (%d) %s",pid2jid(pidToStateChange), pidToStateChange, jobToChange->cmdline);
-            killpg(getpgid(pidToStateChange), SIGCONT); // restart process
-            
-            waitfg(pidToStateChange); // this may not be right
-        }
-        else if(jobToChange->state == BG){
-            // foreground process first
-            jobToChange->state = FG;
-            int test = fgpid(jobs);
-            assert((test > 0) && "There can only be one FG job");
-            debugLog("[%d] (%d) %s",pid2jid(pidToStateChange), pidToStateChange, jobToChange->cmdline);
-            waitfg(pidToStateChange);
-            
-            // new process terminated so we have to fg fg process
-        }
-        else{
-            // state = FG do nothing
-        }
-    }
-    else{
-        // background process
-        if (jobToChange->state == ST) {
-            printf("[%d] (%d) %s",pid2jid(pidToStateChange), pidToStateChange, jobToChange->cmdline);
-            killpg(getpgid(pidToStateChange), SIGCONT);
-        }
-        else{
-            // state = BG or FG do nothing
-        }
-        jobToChange->state = BG;
-    }
-    
-    
-    return;
-}
-
-/*
- * testForChars(char* tmp) test if there are any of the disallowed chars in tmp
- *
- */
-int hasDisallowedChars(char* tmp){
-    const char *disallowedChars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    char *iterator = tmp;
-    while (*iterator)
-    {
-        if (strchr(disallowedChars, *iterator))
-            return 1;
-        
-        iterator++;
-    }
-    return 0;
-}
-
-/*
- * waitfg - Block until process pid is no longer the foreground process based on job list
- */
-void waitfg(pid_t pid){
-    int returnedStatus;
-    int signalingPID = waitpid(pid, &returnedStatus, WUNTRACED);
-    fflush(stdout);
-    
-    if (signalingPID == -1) {
-        debugLog("waitpid returned error in waitfg");
-        fflush(stdout);
-        return;
-    }
-    else if (WIFEXITED(returnedStatus)){
-        // process terminated by exit clean up child by killig it
-        debugLog("FG process %d terminated with exit status %d\n", signalingPID, WEXITSTATUS(returnedStatus));
-        fflush(stdout);
-        deletejob(jobs, signalingPID);
-        killpg(getpgid(signalingPID), SIGTERM);
-    }
-    else if(WIFSIGNALED(returnedStatus)){
-        // terminated by a signal
-        int signal = WTERMSIG(returnedStatus);
-        printf("Job [%d] (%d) terminated by signal %d\n",pid2jid(signalingPID),signalingPID,signal);
-        fflush(stdout);
-        deletejob(jobs, signalingPID);
-        killpg(getpgid(signalingPID), SIGTERM);
-    }
-    else if (WIFSTOPPED(returnedStatus)){
-        printf("Job [%d] (%d) stopped by signal %d\n", pid2jid(signalingPID),signalingPID ,WSTOPSIG(returnedStatus));
-        fflush(stdout);
-        struct job_t* tmp = getjobpid(jobs, signalingPID);
-        tmp->state = ST;
-    }
-    else{
-        debugLog("FG process %d terminated wierdly\n", signalingPID);
-        fflush(stdout);
-        killpg(getpgid(signalingPID), SIGTERM);
-    }
-//    while (pid == fgpid(jobs) || fgpid(jobs) != 0) {
-//        sleep(.5);
-//    }
-    return;
-}
-
-/*****************
- * Signal handlers
- *****************/
-
-/*
- * sigchld_handler - The kernel sends a SIGCHLD to the shell whenever
- *     a child job terminates (becomes a zombie), or stops because it
- *     received a SIGSTOP or SIGTSTP signal. The handler reaps all
- *     available zombie children, but doesn't wait for any other
- *     currently running children to terminate.
- */
-void sigchld_handler(int sig)
-{
-    if (sig == SIGCHLD){
-        int returnedStatus;
-        int signalingPID = 0;
-        while ((signalingPID = waitpid(-1, &returnedStatus, WNOHANG)) > 0) {
-            debugLog("SIGCHLD recieved from pid: %d\n", signalingPID);
-            fflush(stdout);
-            
-            if (WIFEXITED(returnedStatus)){
-                // process terminated by exit clean up child by killig it
-                debugLog("Child %d terminated with exit status %d\n", signalingPID, WEXITSTATUS(returnedStatus));
-                fflush(stdout);
-                killpg(getpgid(signalingPID), SIGTERM);
-                deletejob(jobs, signalingPID);
-            }
-            else if(WIFSIGNALED(returnedStatus)){
-                // terminated by a signal
-                int signal = WTERMSIG(returnedStatus);
-                printf("Job [%d] (%d) terminated by signal %d\n",pid2jid(signalingPID),signalingPID,signal);
-                fflush(stdout);
-                deletejob(jobs, signalingPID);
-                killpg(getpgid(signalingPID), SIGTERM);
-            }
-            else if (WIFSTOPPED(returnedStatus)){
-                debugLog("Child %d was stopped.\n", signalingPID);
-                fflush(stdout);
-                struct job_t* tmp = getjobpid(jobs, signalingPID);
-                tmp->state = ST;
-            }
-            else{
-                debugLog("Child %d terminated wierdly\n", signalingPID);
-                fflush(stdout);
-                killpg(getpgid(signalingPID), SIGTERM);
-            }
-            
-        }
-        return;
-    }
-}
-
-/*
- * sigint_handler - The kernel sends a SIGINT to the shell whenver the
- *    user types ctrl-c at the keyboard.  Catch it and send it along
- *    to the foreground job.
- */
-void sigint_handler(int sig)
-{
-    if (sig == SIGINT){
-        printf("\n");
-        debugLog("User Pressed ctrl-c\n");
-        debugLog("Killing Foreground job\n");
-        
-        pid_t fgPID = fgpid(jobs);
-        debugLog("fgPID = %d\n",fgPID);
-        // we want to send sigint to all process in fgPID's process group
-        int fgGID = getpgid(fgPID);
-        if (fgPID > 0) {
-            killpg(fgGID,SIGINT);
-            debugLog("Forwarded SIGINT to pid: %d\n", fgPID);
-        }
-        else{
-            debugLog("No fg process ignoring SIGINT\n");
-            printf("%s",prompt);
-        }
-        fflush(stdout);
-    }
-    
-    return;
-}
-
-
-/*
- * sigtstp_handler - The kernel sends a SIGTSTP to the shell whenever
- *     the user types ctrl-z at the keyboard. Catch it and suspend the
- *     foreground job by sending it a SIGTSTP.
- */
-void sigtstp_handler(int sig)
-{
-    if (sig == SIGTSTP){
-        printf("\n");
-        debugLog("User Pressed ctrl-z\n");
-        debugLog("Stopping Foreground job\n");
-        
-        pid_t fgPID = fgpid(jobs);
-        int fgGID = getpgid(fgPID);
-        
-        debugLog("fgPID = %d\n",fgPID);
-        if (fgPID > 0) {
-            killpg(fgGID,SIGTSTP);
-            debugLog("Forwarded SIGTSTP to pid: %d\n", fgPID);
-            struct job_t* tmp = getjobpid(jobs, fgPID);
-            tmp->state = ST;
-        }
-        else{
-            debugLog("No fg process ignoring SIGTSTP\n");
-            printf("%s",prompt);
-        }
-        fflush(stdout);
-    }
-    return;
-}
-
-/*********************
- * End signal handlers
- *********************/
-#pragma mark Given Helper Functions
-/***********************************************
- * Helper routines that manipulate the job list
- **********************************************/
-
-/* clearjob - Clear the entries in a job struct */
-void clearjob(struct job_t *job) {
-    job->pid = 0;
-    job->jid = 0;
-    job->state = UNDEF;
-    job->cmdline[0] = '\0';
-}
-
-/* initjobs - Initialize the job list */
-void initjobs(struct job_t *jobs) {
-    int i;
-    
-    for (i = 0; i < MAXJOBS; i++)
-        clearjob(&jobs[i]);
-}
-
-/* maxjid - Returns largest allocated job ID */
-int maxjid(struct job_t *jobs)
-{
-    int i, max=0;
-    
-    for (i = 0; i < MAXJOBS; i++)
-        if (jobs[i].jid > max)
-            max = jobs[i].jid;
-    return max;
-}
-
-/* addjob - Add a job to the job list */
-int addjob(struct job_t *jobs, pid_t pid, int state, char *cmdline)
-{
-    int i;
-    
-    if (pid < 1)
-        return 0;
-    
-    for (i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].pid == 0) {
-            jobs[i].pid = pid;
-            jobs[i].state = state;
-            jobs[i].jid = nextjid++;
-            if (nextjid > MAXJOBS)
-                nextjid = 1;
-            strcpy(jobs[i].cmdline, cmdline);
-            if(verbose){
-                printf("Added job [%d] %d %s\n", jobs[i].jid, jobs[i].pid, jobs[i].cmdline);
-            }
-            return 1;
-        }
-    }
-    printf("Tried to create too many jobs\n");
-    return 0;
-}
-
-/* deletejob - Delete a job whose PID=pid from the job list */
-int deletejob(struct job_t *jobs, pid_t pid)
-{
-    int i;
-    
-    if (pid < 1)
-        return 0;
-    
-    for (i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].pid == pid) {
-            clearjob(&jobs[i]);
-            nextjid = maxjid(jobs)+1;
-            return 1;
-        }
-    }
-    return 0;
-}
-
-/* fgpid - Return PID of current foreground job, 0 if no such job */
-pid_t fgpid(struct job_t *jobs) {
-    int i;
-    
-    for (i = 0; i < MAXJOBS; i++)
-        if (jobs[i].state == FG)
-            return jobs[i].pid;
-    return 0;
-}
-
-/* getjobpid  - Find a job (by PID) on the job list */
-struct job_t *getjobpid(struct job_t *jobs, pid_t pid) {
-    int i;
-    
-    if (pid < 1)
-        return NULL;
-    for (i = 0; i < MAXJOBS; i++)
-        if (jobs[i].pid == pid)
-            return &jobs[i];
-    return NULL;
-}
-
-/* getjobjid  - Find a job (by JID) on the job list */
-struct job_t *getjobjid(struct job_t *jobs, int jid)
-{
-    int i;
-    
-    if (jid < 1)
-        return NULL;
-    for (i = 0; i < MAXJOBS; i++)
-        if (jobs[i].jid == jid)
-            return &jobs[i];
-    return NULL;
-}
-
-/* pid2jid - Map process ID to job ID */
-int pid2jid(pid_t pid)
-{
-    int i;
-    
-    if (pid < 1)
-        return 0;
-    for (i = 0; i < MAXJOBS; i++)
-        if (jobs[i].pid == pid) {
-            return jobs[i].jid;
-        }
-    return 0;
-}
-
-/* listjobs - Print the job list */
-void listjobs(struct job_t *jobs)
-{
-    int i;
-    
-    for (i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].pid != 0) {
-            printf("[%d] (%d) ", jobs[i].jid, jobs[i].pid);
-            switch (jobs[i].state) {
-                case BG:
-                    printf("Running ");
-                    break;
-                case FG:
-                    printf("Foreground ");
-                    break;
-                case ST:
-                    printf("Stopped ");
-                    break;
-                default:
-                    printf("listjobs: Internal error: job[%d].state=%d ",
-                           i, jobs[i].state);
-            }
-            printf("%s", jobs[i].cmdline);
-        }
-    }
-}
-
-void terminateAllUnexitedJobs(struct job_t* jobs){
-    int i;
-    
-    for (i = 0; i < MAXJOBS; i++) {
-        if (jobs[i].pid != 0) {
-            debugLog("%s with PID: %d was left and killed.",jobs[i].cmdline, jobs[i].pid);
-            killpg(getpgid(jobs[i].pid), SIGKILL);
-        }
-    }
-}
-        /******************************
- * end job list helper routines
- ******************************/
-
-
-/***********************
- * Other helper routines
- ***********************/
-
-/*
- * usage - print a help message
- */
-void usage(void)
-{
-    printf("Usage: shell [-hvp]\n");
-    printf("   -h   print this message\n");
-    printf("   -v   print additional diagnostic information\n");
-    printf("   -p   do not emit a command prompt\n");
-    exit(1);
-}
-
-/*
- * unix_error - unix-style error routine
- */
-void unix_error(char *msg)
-{
-    fprintf(stdout, "%s: %s\n", msg, strerror(errno));
-    exit(1);
-}
-
-/*
- * app_error - application-style error routine
- */
-void app_error(char *msg)
-{
-    fprintf(stdout, "%s\n", msg);
-    exit(1);
-}
-
-/*
- * Signal - wrapper for the sigaction function
- */
-handler_t *Signal(int signum, handler_t *handler)
-{
-    struct sigaction action, old_action;
-    
-    action.sa_handler = handler;
-    sigemptyset(&action.sa_mask); /* block sigs of type being handled */
-    action.sa_flags = SA_RESTART; /* restart syscalls if possible */
-    
-    if (sigaction(signum, &action, &old_action) < 0)
-        unix_error("Signal error");
-    return (old_action.sa_handler);
-}
-
-/*
- * sigquit_handler - The driver program can gracefully terminate the
- *    child shell by sending it a SIGQUIT signal.
- */
-void sigquit_handler(int sig)
-{
-    printf("Terminating after receipt of SIGQUIT signal\n");
-    exit(1);
-}
-
-
-
+/*
+ * tsh - A tiny shell program with job control
+ *
+ * Trent Callan
+ * SID: 861117907
+ *
+ * 2017 Copyright Trent Callan
+ * This is my unique code written fully by the named above and is not to be used in any other way.
+ */
+
+
+////// Just ONE BIG QUESTION should processes left stopped or backgrounded be killed by the shell when it exits or should they be left to other shells.
+// also is sleep before unblocking SIGCHLD in child process necessary?
+#define _GNU_SOURCE         /* ppoll */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <linux/sched.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <dirent.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "libtsh.h"
+
+/* Misc manifest constants */
+#define MAXLINE    1024   /* max line size */
+#define MAXARGS     128   /* max args on a command line */
+#define MAXJOBS TSH_MAXJOBS /* max jobs at any point in time */
+#define MAXJID    1<<16   /* max job ID */
+#define MYFGGROUPID   7907
+#define FSMAXMSG  65536   /* max fork server request size */
+#define FSTIMEOUT     1   /* seconds to wait for the fork server's reply */
+#define MAXEVENTS   256   /* signal event queue size, a power of 2 */
+#define MAXNOTIFY  8192   /* max pending job notification bytes */
+#define MAXOUTPUT 16384   /* max pending shell output bytes */
+#define MAXGLOBDIRS  16   /* max directories cached per command line */
+#define DENTBUFSIZE (1<<20) /* getdents64 buffer size */
+#define MAXALARMS  4096   /* max pending deadline timers */
+#define KILLGRACE     2   /* seconds from SIGTERM to SIGKILL on a deadline */
+#define THROTTLEMS  100   /* throttle duty cycle period in milliseconds */
+#define MEMCHECKMS 1000   /* how often memguard looks whether pressure is down */
+#define MEMQUIET      5   /* seconds with low pressure before memguard resumes a job */
+#define MAXDAGNODES  64   /* max jobs in a dag file */
+#define MAXDAGNAME   32   /* max dag job name length */
+#define MAXRECORDS (1<<16) /* event recorder ring size, a power of 2 */
+
+/* Job states */
+#define UNDEF TSH_UNDEF /* undefined */
+#define FG TSH_FG       /* running in foreground */
+#define BG TSH_BG       /* running in background */
+#define ST TSH_ST       /* stopped */
+
+/* Command connectors: how a command joins the next one */
+#define CON_END 0   /* last command on the line */
+#define CON_SEQ 1   /* ; */
+#define CON_BG  2   /* & */
+#define CON_AND 3   /* && */
+#define CON_OR  4   /* || */
+
+/* Command types */
+#define CMD_SIMPLE 1 /* words to expand and run */
+#define CMD_FOR    2 /* for VAR in WORDS; do BODY; done */
+#define CMD_WHILE  3 /* while COND; do BODY; done */
+#define CMD_REPEAT 4 /* repeat N COMMAND */
+
+/* Signal event kinds */
+#define EV_NONE  0  /* reserved slot that turned out to be unused */
+#define EV_CHILD 1  /* child reaped or stopped, status from waitpid */
+#define EV_INT   2  /* SIGINT (ctrl-c) received */
+#define EV_TSTP  3  /* SIGTSTP (ctrl-z) received */
+
+/* Deadline timer kinds */
+#define AL_TERM 1   /* deadline passed: SIGTERM the job */
+#define AL_KILL 2   /* still there after the grace period: SIGKILL */
+#define AL_PAUSE 3  /* throttled job used its share of the period: SIGSTOP */
+#define AL_RESUME 4 /* throttled job's pause is over: SIGCONT */
+#define AL_MEMCHECK 5 /* memguard: resume a job if memory pressure is down */
+
+/* Event recorder record kinds, _BEGIN/_END pairs become spans */
+#define REC_LINE_BEGIN  1  /* command line read, arg = length */
+#define REC_LINE_END    2  /* command line evaluated */
+#define REC_PARSE_BEGIN 3  /* parsing the command line */
+#define REC_PARSE_END   4
+#define REC_SPAWN_BEGIN 5  /* launching a job, pid = 0 */
+#define REC_SPAWN_END   6  /* launched, pid = child, arg = 1 via fork server */
+#define REC_EXEC        7  /* child about to execve */
+#define REC_SIGNAL      8  /* handler entered, arg = signal */
+#define REC_REAP        9  /* handler reaped pid, arg = wait status */
+#define REC_STATE      10  /* job pid changed state, arg = FG, BG, ST or UNDEF */
+#define REC_EVENT      11  /* main loop handled a queued event, arg = kind */
+#define REC_WAIT_BEGIN 12  /* waiting for foreground job pid */
+#define REC_WAIT_END   13
+#define REC_DUMP       14  /* recorder dumped, arg = records written so far */
+
+/* Dag job states */
+#define DAG_PENDING   0 /* waiting for dependencies or a free slot */
+#define DAG_RUNNING   1 /* started as a background job */
+#define DAG_EXITED    2 /* reaped, status not looked at yet */
+#define DAG_DONE      3 /* exited with status 0 */
+#define DAG_FAILED    4 /* failed or could not be started */
+#define DAG_CANCELLED 5 /* a dependency failed */
+
+/*
+ * Jobs states: FG (foreground), BG (background), ST (stopped)
+ * Job state transitions and enabling actions:
+ *     FG -> ST  : ctrl-z
+ *     ST -> FG  : fg command
+ *     ST -> BG  : bg command
+ *     BG -> FG  : fg command
+ * At most 1 job can be in the FG state.
+ */
+
+// my debug verbose function
+static inline int doNothing(char const* format,...){ return 0; };
+
+int (*debugLog)(char const *,...) = &doNothing;
+
+
+
+/* Global variables */
+extern char **environ;      /* defined in libc */
+char prompt[] = "tsh> ";    /* command line prompt (DO NOT CHANGE) */
+int verbose = 0;            /* if true, print additional output */
+int emit_prompt = 1;        /* emit prompt (default) */
+int nextPGID = 100;         // next process group id to allocate
+int forkServerFd = -1;      // shell's end of the fork server socket, -1 if none
+pid_t forkServerPid = -1;   // the fork server's pid, -1 if none
+int launchedByServer = 0;   // the last job launch went through the fork server
+int lastStatus = 0;         // exit status of the last command, for && || and $?
+int lineInterrupted = 0;    // ctrl-c hit the running line, skip the rest of it
+int lineRunning = 0;        // eval is running a line, a ctrl-c interrupts it
+int inSubshell = 0;         // running a background list in a forked copy of the shell
+char sbuf[MAXLINE];         /* for composing sprintf messages */
+
+struct tsh_ctx shell;       /* The job list, kept by libtsh */
+struct tsh_job *jobs = shell.jobs; /* its jobs */
+
+struct jobinfo_t {          /* What the shell keeps per job beyond libtsh */
+    struct timespec deadline; /* CLOCK_MONOTONIC time limit, 0 if none */
+    int timedOut;           /* deadline passed and the job was signaled */
+    int throttle;           /* CPU share limit in percent, 0 if none */
+    int throttlePaused;     /* the throttle holds it stopped right now */
+    struct timespec throttleNext; /* when the next pause or resume is due */
+    struct timespec throttleSince; /* when throttling started */
+    long throttleCpu;       /* job's CPU time in us when throttling started */
+    int memStopped;         /* memguard stopped it, memguard resumes it */
+    struct timespec memStoppedAt; /* when memguard stopped it */
+};
+struct jobinfo_t jobInfo[MAXJOBS]; /* indexed like shell.jobs */
+
+/*
+ * Job deadlines live in one min-heap behind a single timerfd that is
+ * armed for the earliest one. Entries are never removed when a job ends
+ * or gets a new deadline; they are checked against the job when they
+ * come due and dropped if they no longer match.
+ */
+struct alarm_t {            /* A pending deadline timer */
+    struct timespec when;   /* CLOCK_MONOTONIC expiry */
+    pid_t pid;              /* job it belongs to */
+    int kind;               /* AL_TERM, AL_KILL, AL_PAUSE, AL_RESUME or AL_MEMCHECK */
+};
+struct alarm_t alarms[MAXALARMS]; /* the heap, earliest first */
+int alarmCount = 0;         /* used entries in alarms */
+int timerFd = -1;           /* timerfd armed for alarms[0] */
+
+int psiFd = -1;             /* memguard's /proc/pressure/memory trigger, -1 if off */
+long psiStallUsec = 0;      /* trigger: memory stall time ... */
+long psiWindowUsec = 0;     /* ... per window */
+struct timespec memLastAction; /* last trigger or resume, for the quiet period */
+struct timespec memCheckNext;  /* pending AL_MEMCHECK, 0 if none */
+
+struct dagnode_t {          /* A job of a dag file */
+    char name[MAXDAGNAME];  /* name dependencies refer to it by */
+    char command[MAXLINE];  /* and-or list to run, with " &\n" added */
+    double cost;            /* rough run time, for ranking */
+    double rank;            /* cost of the longest path from here to the end */
+    int dep[MAXDAGNODES];   /* indexes of the jobs it depends on */
+    int depCount;           /* used entries in dep */
+    int waiting;            /* dependencies not done yet */
+    int state;              /* DAG_PENDING ... DAG_CANCELLED */
+    pid_t pid;              /* job pid while running */
+    int status;             /* wait status once reaped */
+};
+struct dagnode_t dagNodes[MAXDAGNODES]; /* the dag being run */
+int dagCount = 0;           /* used entries in dagNodes */
+int dagRunning = 0;         /* dag builtin is waiting for its jobs */
+int dagChanged = 0;         /* one of its jobs was reaped */
+
+char inBuf[MAXLINE];        /* stdin bytes read past the current line */
+size_t inLen = 0;           /* bytes used in inBuf */
+int inEOF = 0;              /* stdin hit end of file */
+
+/*
+ * A command line is parsed once into a list of commands. The words are
+ * kept unexpanded so $VAR and globs are expanded each time a command
+ * runs; src keeps the line as typed for the job list. A loop is one
+ * command in the list with its body (and while condition) hanging off
+ * it, so every iteration reuses the same parsed commands.
+ */
+struct cmd_t {              /* A parsed command */
+    int type;               /* CMD_SIMPLE, CMD_FOR, CMD_WHILE or CMD_REPEAT */
+    int connector;          /* CON_END, CON_SEQ, CON_BG, CON_AND or CON_OR */
+    int argc;               /* number of words */
+    char *argv[MAXARGS];    /* raw words */
+    int quoted[MAXARGS];    /* quoted[i] if argv[i] was 'quoted' */
+    const char *src;        /* line the command came from */
+    int start, end;         /* this command's text in src */
+    char *var;              /* CMD_FOR: loop variable, argv holds the words */
+    struct cmd_t *cond;     /* CMD_WHILE: condition list */
+    struct cmd_t *body;     /* loop body; CMD_REPEAT: the command, argv[0] is N */
+    struct cmd_t *next;     /* next command in the list */
+};
+struct cmdline_t {          /* A parsed command line */
+    char *src;              /* the line as typed, without the \n */
+    char *buf;              /* copy of the line the words point into */
+    struct cmd_t *cmds;     /* first command */
+};
+
+/*
+ * Signal handlers only record what happened in this queue; the main loop
+ * drains it and does the job list changes and output. Handlers can nest
+ * (SIGINT arriving during SIGCHLD) so a slot is claimed with a CAS on
+ * eventTail and published by bumping its seq, there is one consumer.
+ */
+struct event_t {            /* A signal event */
+    atomic_uint seq;        /* slot sequence number */
+    int kind;               /* EV_CHILD, EV_INT or EV_TSTP */
+    pid_t pid;              /* child pid for EV_CHILD */
+    pid_t pgid;             /* its process group, read before reaping */
+    int status;             /* waitpid status for EV_CHILD */
+    long cpuUsec;           /* user+system time of the reaped child */
+    long maxrssKB;          /* its max RSS */
+    struct timespec when;   /* CLOCK_MONOTONIC time of the signal */
+};
+struct event_t eventQueue[MAXEVENTS]; /* The signal event queue */
+atomic_uint eventTail;      /* next slot producers claim */
+unsigned int eventHead;     /* next slot the main loop drains */
+volatile sig_atomic_t eventsOverflowed; /* queue filled up, children left unreaped */
+
+/*
+ * The event recorder keeps the last MAXRECORDS timestamped records in
+ * a ring shared with every process we fork, so the children and the
+ * fork server can record their exec too. Slots are claimed with one
+ * atomic add, which makes recording safe from signal handlers. The
+ * ring is written to recordPath on SIGUSR1 and, with -t, at exit.
+ */
+struct record_t {           /* A recorded event, 24 bytes on disk */
+    int64_t ns;             /* CLOCK_MONOTONIC time */
+    int32_t kind;           /* REC_* */
+    int32_t self;           /* process that recorded it */
+    int32_t pid;            /* process it is about */
+    int32_t arg;            /* kind specific */
+};
+struct recorder_t {
+    atomic_ulong next;      /* records ever written */
+    struct record_t records[MAXRECORDS];
+};
+struct recorder_t *recorder = NULL; /* shared mapping, NULL if mmap failed */
+pid_t recordSelf = 0;       /* our pid, for the self field */
+pid_t shellPid = 0;         /* the shell itself, only it dumps at exit */
+char recordPath[MAXLINE];   /* where the ring is dumped */
+
+/*
+ * Everything the shell prints is collected in outBuf and written at a
+ * few fixed points: before we fork, before we block waiting for input
+ * or a job, and with the prompt, where outBuf, the notifications and
+ * the prompt go out together in one writev.
+ */
+char outBuf[MAXOUTPUT];     /* pending shell output */
+size_t outLen = 0;          /* bytes used in outBuf */
+
+/*
+ * Background job notifications are held here and written in one go
+ * right before the next prompt, like bash. set -b prints them as soon
+ * as the main loop sees the event instead.
+ */
+char notifyBuf[MAXNOTIFY];  /* pending notifications */
+size_t notifyLen = 0;       /* bytes used in notifyBuf */
+int notifyNow = 0;          /* set -b: don't defer notifications */
+
+struct globdir_t {          /* A cached directory listing */
+    char *path;             /* directory as written, "" for . */
+    char *names;            /* NUL separated entry names */
+    char **entries;         /* pointers into names */
+    int count;              /* number of entries */
+    int busy;               /* globPath is walking it, don't evict it */
+    int cached;             /* in globDirs, else freed by releaseGlobDir */
+};
+struct globdir_t globDirs[MAXGLOBDIRS]; /* listings read for this command line */
+int globDirCount = 0;       /* used entries in globDirs */
+int globDirNext = 0;        /* where to look for a listing to evict */
+char *lineWords[2*MAXARGS]; /* malloc'd words handed out for this command line */
+int lineWordCount = 0;      /* used entries in lineWords */
+
+struct var_t {              /* A shell variable */
+    char *entry;            /* "NAME=value", also used as the environ entry */
+    size_t nameLen;         /* length of NAME */
+    int exported;           /* passed to commands we run? */
+};
+struct var_t *vars = NULL;  /* The variable list */
+int varCount = 0;           /* used entries in vars */
+int varCapacity = 0;        /* allocated entries in vars */
+char **exportEnv = NULL;    /* cached environment for execve, NULL when stale */
+/* End global variables */
+
+
+/* Function prototypes */
+
+/*********************************
+ * My Changes To Given Functions
+ * int parseLine(const char *cmdline, char **argv);
+ * replaced by parseCommandLine which also splits on ; & && || and
+ * keeps which words were 'quoted', argc now comes from expandGlobs
+ * int builtin_cmd(char **argv, int argc);
+ * i modified this toallow the passing of argc to built in functions
+ * void do_bgfg(char **argv,argc);
+ * i modified this toallow the passing of argc to bg and fg
+ 
+ */
+
+
+/* Here are the functions that you will implement */
+void eval(char *cmdline);
+void runList(struct cmd_t *cmd);
+void runAndOr(struct cmd_t *first, struct cmd_t *last);
+pid_t runBackgroundList(struct cmd_t *first, struct cmd_t *last);
+pid_t runCommand(struct cmd_t *cmd, int runInBackground, char *text);
+void runInSubshell(char *path, char **argv, char **assignments, int assignCount);
+void commandText(struct cmd_t *first, struct cmd_t *last, char *text);
+void runNode(struct cmd_t *cmd);
+void runFor(struct cmd_t *cmd);
+void runWhile(struct cmd_t *cmd);
+void runRepeat(struct cmd_t *cmd);
+int builtin_cmd(char **argv, int argc);
+int isBuiltin(const char *name);
+void do_bgfg(char **argv, int argc);
+void waitfg(pid_t pid);
+int getNextPGID();
+
+// fork server
+void startForkServer(void);
+void forkServerLoop(int fd);
+pid_t forkServerSpawn(char *path, char **argv, char **envp, int *pidfd);
+void stopForkServer(const char *reason);
+
+// libtsh job table
+void initShellJobs(void);
+void jobChanged(struct tsh_ctx *ctx, struct tsh_job *job, int oldState, void *arg);
+pid_t launchJob(void *arg, char *path, char **argv, char **envp, int *pidfd);
+void beforeJobExec(void *arg);
+void jobExecFailed(void *arg, const char *path);
+
+void sigchld_handler(int sig);
+void sigtstp_handler(int sig);
+void sigint_handler(int sig);
+
+// signal event queue
+void initevents(void);
+struct event_t *reserveEvent(unsigned int *pos);
+void publishEvent(struct event_t *event, unsigned int pos);
+void pushEvent(int kind);
+void drainEvents(void);
+void handleEvent(struct event_t *event);
+void retireJob(struct tsh_job *job);
+
+// event recorder
+void initrecorder(const char *path);
+void record(int kind, pid_t pid, int arg);
+void dumpRecords(void);
+void sigusr1_handler(int sig);
+
+// shell output
+int outPrintf(const char *format, ...);
+int vOutPrintf(const char *format, va_list args);
+void flushOutput(void);
+void writeOut(struct iovec *vec, int count);
+
+// job notifications
+void notify(const char *format, ...);
+void flushNotifications(const char *trailer);
+
+// deadline timers
+void inittimers(void);
+int parseDuration(const char *text, struct timespec *duration);
+void setDeadline(struct tsh_job *job, const struct timespec *duration);
+void addAlarm(struct timespec when, pid_t pid, int kind);
+struct alarm_t popAlarm(void);
+int alarmBefore(const struct alarm_t *a, const struct alarm_t *b);
+void purgeAlarms(void);
+void armTimer(void);
+void runAlarms(void);
+int readLine(char *cmdline, int size);
+int pollTimers(int fd, const sigset_t *mask);
+
+// job throttling
+void do_throttle(char **argv, int argc);
+void throttleAlarm(struct tsh_job *job, struct timespec from, int kind, long msec);
+void unthrottleJob(struct tsh_job *job);
+void runThrottle(struct tsh_job *job, struct alarm_t *due, struct timespec now);
+void groupUsage(struct tsh_job *job, long *cpuUsec, long *rssKB);
+
+// memory pressure guard
+void do_memguard(char **argv, int argc);
+void runMemGuard(void);
+void runMemCheck(struct timespec now);
+double memPressure(void);
+
+// job dags
+void do_dag(char **argv, int argc);
+int loadDag(const char *path);
+void freeDagNames(char **depNames);
+int findDagNode(const char *name);
+int dagDependsOn(struct dagnode_t *node, int index);
+int cancelDagDependents(int index);
+int startDagNode(struct dagnode_t *node);
+void dagJobDone(pid_t pid, int status);
+
+// my helper functions
+struct cmdline_t *parseCommandLine(const char *cmdline);
+void freeCommandLine(struct cmdline_t *line);
+struct cmd_t *groupLoops(struct cmd_t **list, char *buf, const char *stopWord,
+                         struct cmd_t **stopCmd, const char **error);
+int startsWith(struct cmd_t *cmd, const char *word);
+void shiftWords(struct cmd_t *cmd, int count, char *buf);
+void freeCmds(struct cmd_t *cmd);
+
+// glob expansion
+int expandGlobs(char **argv, int *quoted);
+int hasGlobChars(const char *word);
+int compareNames(const void *a, const void *b);
+int globPath(const char *dir, char *pattern, char **matches, int count);
+struct globdir_t *readGlobDir(const char *dir);
+void releaseGlobDir(struct globdir_t *listing);
+void freeGlobDir(struct globdir_t *listing);
+void clearLineCache(void);
+void clearLineWords(void);
+char *keepLineWord(char *word);
+
+// shell variables
+void initvars(void);
+struct var_t *findvar(const char *name, size_t nameLen);
+char *getvar(const char *name, size_t nameLen);
+void setvar(const char *name, size_t nameLen, const char *value, int exported);
+void unsetvar(const char *name);
+int isAssignment(const char *word);
+int takeAssignments(char **argv, int *quoted, char **assignments);
+int expandVars(char **argv, int *quoted);
+char *expandWord(char *word);
+char **exportedEnviron(void);
+char **overlayEnviron(char **assignments, int count);
+void do_export(char **argv, int argc);
+int hasDisallowedChars(char* tmp);
+int selectJobs(char **args, int count, const char *commandName, struct tsh_job **selected);
+void do_signalJobs(char **argv, int argc);
+void terminateAllUnexitedJobs(struct tsh_job* jobs);
+
+/* Here are helper routines that we've provided for you */
+void sigquit_handler(int sig);
+
+struct jobinfo_t *jobinfo(struct tsh_job *job);
+void listjobs(struct tsh_job *jobs);
+void listjob(struct tsh_job *job);
+void listjobsLong(struct tsh_job *jobs);
+
+void usage(void);
+void unix_error(char *msg);
+void app_error(char *msg);
+typedef void handler_t(int);
+handler_t *Signal(int signum, handler_t *handler);
+
+/*
+ * main - The shell's main routine
+ */
+int main(int argc, char **argv)
+{
+    char c;
+    char cmdline[MAXLINE];
+    char *traceFile = NULL;
+    
+    /* Redirect stderr to stdout (so that driver will get all output
+     * on the pipe connected to stdout) */
+    dup2(1, 2);
+    
+    /* Shell output is batched in outBuf, so stdio must not hold a second
+     * copy that a forked child could write out again */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    
+    /* Parse the command line */
+    while ((c = getopt(argc, argv, "hvpzt:")) != EOF) {
+        switch (c) {
+            case 'h':             /* print help message */
+                usage();
+                break;
+            case 'v':             /* emit additional diagnostic info */
+                verbose = 1;
+                debugLog = &outPrintf;
+                break;
+            case 'p':             /* don't print a prompt */
+                emit_prompt = 0;  /* handy for automatic testing */
+                break;
+            case 'z':             /* launch jobs through a fork server */
+                forkServerFd = 0;
+                break;
+            case 't':             /* dump the event recorder here at exit */
+                traceFile = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+    
+    /* Map the recorder before the fork server so it shares the ring */
+    initrecorder(traceFile);
+    
+    /* Start the fork server while the shell is still small */
+    if (forkServerFd == 0) {
+        startForkServer();
+    }
+    
+    /* Initialize the signal event queue before any handler can push */
+    initevents();
+    
+    /* Install the signal handlers */
+    
+    /* These are the ones you will need to implement */
+    Signal(SIGINT,  sigint_handler);   /* ctrl-c */
+    Signal(SIGTSTP, sigtstp_handler);  /* ctrl-z */
+    Signal(SIGCHLD, sigchld_handler);  /* Terminated or stopped child */
+    
+    /* This one provides a clean way to kill the shell */
+    Signal(SIGQUIT, sigquit_handler);
+    
+    /* Dump the event recorder on demand */
+    Signal(SIGUSR1, sigusr1_handler);
+    
+    /* Orphaned descendants of our jobs get reparented to us, not init */
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1) < 0) {
+        debugLog("Could not become a subreaper: %s\n", strerror(errno));
+    }
+    
+    /* Initialize the job list */
+    initShellJobs();
+    
+    /* Copy the environment into the shell variables */
+    initvars();
+    
+    /* Create the timerfd behind job deadlines */
+    inittimers();
+    
+    /* Execute the shell's read/eval loop */
+    while (1) {
+        
+        /* Apply whatever the handlers queued while we were busy */
+        drainEvents();
+        
+        /* Read command line, pending notifications go out with the prompt */
+        flushNotifications(emit_prompt ? prompt : "");
+        if (!readLine(cmdline, MAXLINE)) { /* End of file (ctrl-d) */
+            drainEvents();
+            flushNotifications("");
+            exit(0);
+        }
+        
+        /* Evaluate the command line */
+        record(REC_LINE_BEGIN, 0, strlen(cmdline));
+        eval(cmdline);
+        record(REC_LINE_END, 0, 0);
+    }
+    // removing control never reaches warning
+    //exit(0); /* control never reaches here */
+}
+
+#pragma mark User Implemented Functions
+
+/*
+ * eval - Evaluate the command line that the user has just typed in
+ *
+ * If the user has requested a built-in command (quit, jobs, bg or fg)
+ * then execute it immediately. Otherwise, fork a child process and
+ * run the job in the context of the child. If the job is running in
+ * the foreground, wait for it to terminate and then return.  Note:
+ * each child process must have a unique process group ID so that our
+ * background children don't receive SIGINT (SIGTSTP) from the kernel
+ * when we type ctrl-c (ctrl-z) at the keyboard.
+ */
+void eval(char *cmdLine)
+{
+    if (!strcmp("\n", cmdLine)) {
+        debugLog("Command Line is Empty\n");
+        return;
+    }
+    assert(strcmp("\n", cmdLine) && "commandLine must not be empty");
+    
+    debugLog("cmdLine = %s",cmdLine);
+    drainEvents();
+    
+    record(REC_PARSE_BEGIN, 0, 0);
+    struct cmdline_t *line = parseCommandLine(cmdLine);
+    record(REC_PARSE_END, 0, 0);
+    if (!line) {
+        // syntax error, already reported
+        lastStatus = 2;
+        return;
+    }
+    lineInterrupted = 0;
+    lineRunning = 1;
+    runList(line->cmds);
+    lineRunning = 0;
+    freeCommandLine(line);
+    clearLineCache();
+    return;
+}
+
+/*
+ * runList - Run a list of commands in order. Commands joined by && and ||
+ *    form an and-or list; a list ending in & runs in the background as
+ *    one job, the rest run in the foreground one command at a time.
+ */
+void runList(struct cmd_t *cmd)
+{
+    struct cmd_t *last;
+    char text[MAXLINE];
+    
+    // builtins never wait for events, so pick up a ctrl-c between commands
+    drainEvents();
+    while (cmd && !lineInterrupted) {
+        last = cmd;
+        while (last->connector == CON_AND || last->connector == CON_OR)
+            last = last->next;
+        
+        if (last->connector != CON_BG) {
+            runAndOr(cmd, last);
+        }
+        else if (cmd == last && cmd->type == CMD_SIMPLE) {
+            // a plain cmd & is an ordinary background job
+            commandText(cmd, cmd, text);
+            runCommand(cmd, 1, text);
+        }
+        else {
+            runBackgroundList(cmd, last);
+        }
+        cmd = last->next;
+        drainEvents();
+    }
+}
+
+/*
+ * runAndOr - Run first, then each following command up to last if the
+ *    status so far allows it (&& needs 0, || needs non-zero)
+ */
+void runAndOr(struct cmd_t *first, struct cmd_t *last)
+{
+    struct cmd_t *cmd;
+    
+    runNode(first);
+    for (cmd = first; cmd != last && !lineInterrupted; cmd = cmd->next) {
+        drainEvents();
+        if (lineInterrupted) {
+            break;
+        }
+        if ((cmd->connector == CON_AND) == (lastStatus == 0)) {
+            runNode(cmd->next);
+        }
+    }
+}
+
+/*
+ * runNode - Run one command of an and-or list in the foreground: a
+ *    loop here, a simple command through runCommand
+ */
+void runNode(struct cmd_t *cmd)
+{
+    char text[MAXLINE];
+    
+    switch (cmd->type) {
+        case CMD_FOR:
+            runFor(cmd);
+            break;
+        case CMD_WHILE:
+            runWhile(cmd);
+            break;
+        case CMD_REPEAT:
+            runRepeat(cmd);
+            break;
+        default:
+            commandText(cmd, cmd, text);
+            runCommand(cmd, 0, text);
+    }
+}
+
+/*
+ * runFor - Run a for loop: expand the words once, then run the body
+ *    with the variable set to each of them
+ */
+void runFor(struct cmd_t *cmd)
+{
+    char *argv[MAXARGS];
+    int quoted[MAXARGS];
+    char *words[MAXARGS];
+    int count, i;
+    
+    for (i = 0; i < cmd->argc; i++) {
+        argv[i] = cmd->argv[i];
+        quoted[i] = cmd->quoted[i];
+    }
+    argv[i] = NULL;
+    count = expandVars(argv, quoted);
+    if (count > 0) {
+        count = expandGlobs(argv, quoted);
+    }
+    // the body's commands free this line's words, keep our own copies
+    for (i = 0; i < count; i++)
+        words[i] = strdup(argv[i]);
+    clearLineWords();
+    
+    lastStatus = (count < 0);
+    for (i = 0; i < count; i++) {
+        drainEvents();
+        if (lineInterrupted) {
+            break;
+        }
+        setvar(cmd->var, strlen(cmd->var), words[i], -1);
+        runList(cmd->body);
+    }
+    for (i = 0; i < count; i++)
+        free(words[i]);
+}
+
+/*
+ * runWhile - Run a while loop: the body runs as long as the condition
+ *    list ends with status 0. A ctrl-c leaves the loop with its status.
+ */
+void runWhile(struct cmd_t *cmd)
+{
+    int status = 0;
+    
+    while (1) {
+        drainEvents();
+        if (lineInterrupted) {
+            return;
+        }
+        runList(cmd->cond);
+        if (lineInterrupted) {
+            return;
+        }
+        if (lastStatus != 0) {
+            break;
+        }
+        runList(cmd->body);
+        status = lastStatus;
+    }
+    lastStatus = status;
+}
+
+/* runRepeat - Run repeat N COMMAND: COMMAND N times in the foreground */
+void runRepeat(struct cmd_t *cmd)
+{
+    char *argv[2] = { cmd->argv[0], NULL };
+    int quoted[2] = { cmd->quoted[0], 0 };
+    int count, i;
+    
+    if (expandVars(argv, quoted) != 1 || strspn(argv[0], "0123456789") != strlen(argv[0])) {
+        outPrintf("repeat: %s: count must be a number\n", argv[0] ? argv[0] : "");
+        clearLineWords();
+        lastStatus = 2;
+        return;
+    }
+    count = atoi(argv[0]);
+    clearLineWords();
+    
+    lastStatus = 0;
+    for (i = 0; i < count; i++) {
+        drainEvents();
+        if (lineInterrupted) {
+            break;
+        }
+        runNode(cmd->body);
+    }
+}
+
+/*
+ * runBackgroundList - Run an and-or list ending in & as a single job: a
+ *    forked copy of the shell in its own process group runs the
+ *    commands one after another and exits with the list's status.
+ *    Returns the job's pid.
+ */
+pid_t runBackgroundList(struct cmd_t *first, struct cmd_t *last)
+{
+    char text[MAXLINE];
+    sigset_t blockListSet;
+    pid_t childPid;
+    
+    commandText(first, last, text);
+    
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blockListSet, NULL);
+    
+    flushOutput();
+    if ((childPid = fork()) == 0) {
+        // the shell writes whatever it still buffers, don't write it twice
+        outLen = 0;
+        notifyLen = 0;
+        // subshell: plain signal handling so ctrl-c/ctrl-z reach the whole group
+        setpgid(0, 0);
+        recordSelf = getpid();
+        Signal(SIGINT, SIG_DFL);
+        Signal(SIGTSTP, SIG_DFL);
+        Signal(SIGCHLD, SIG_DFL);
+        sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
+        if (forkServerFd >= 0) {
+            close(forkServerFd);
+            forkServerFd = -1;
+            forkServerPid = -1;
+        }
+        close(timerFd);
+        timerFd = -1;
+        if (psiFd >= 0) {
+            close(psiFd);
+            psiFd = -1;
+        }
+        alarmCount = 0;
+        initShellJobs();
+        inSubshell = 1;
+        runAndOr(first, last);
+        // _exit: exit would sync stdin's buffer and rewind the shell's input
+        flushOutput();
+        _exit(lastStatus);
+    }
+    
+    if (childPid < 0) {
+        outPrintf("%.*s: Could not start: %s\n", (int) strlen(text) - 1, text, strerror(errno));
+        sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
+        lastStatus = 1;
+        return 0;
+    }
+    setpgid(childPid, 0);
+    if (!tsh_addjob(&shell, childPid, BG, text)) {
+        outPrintf("Tried to create too many jobs\n");
+    }
+    sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
+    outPrintf("[%d] (%d) %s", tsh_pid2jid(&shell, childPid), childPid, text);
+    lastStatus = 0;
+    return childPid;
+}
+
+/*
+ * runInSubshell - Run a command of a background list: fork, exec and
+ *    wait for it without touching the job list
+ */
+void runInSubshell(char *path, char **argv, char **assignments, int assignCount)
+{
+    char **envp = assignCount ? overlayEnviron(assignments, assignCount) : exportedEnviron();
+    int returnedStatus;
+    pid_t childPid;
+    
+    flushOutput();
+    if ((childPid = fork()) == 0) {
+        outLen = 0;
+        recordSelf = getpid();
+        record(REC_EXEC, recordSelf, 0);
+        execve(path, argv, envp);
+        outPrintf("%s: Command Not Found\n", path);
+        flushOutput();
+        _exit(1);
+    }
+    if (assignCount) {
+        free(envp);
+    }
+    if (childPid < 0 || waitpid(childPid, &returnedStatus, 0) < 0) {
+        lastStatus = 1;
+    }
+    else if (WIFSIGNALED(returnedStatus)) {
+        lastStatus = 128 + WTERMSIG(returnedStatus);
+    }
+    else {
+        lastStatus = WEXITSTATUS(returnedStatus);
+    }
+}
+
+/*
+ * commandText - The job list text for the commands first..last: the
+ *    line as typed from the first one up to the end of the last one,
+ *    with a \n like the command line eval got
+ */
+void commandText(struct cmd_t *first, struct cmd_t *last, char *text)
+{
+    snprintf(text, MAXLINE, "%.*s\n", last->end - first->start, first->src + first->start);
+}
+
+/*
+ * runCommand - Expand and run one simple command: a builtin right here,
+ *    anything else as a new job in the foreground or background.
+ *    text is what the job list shows for it. Returns the new job's
+ *    pid, or 0 if no job was started.
+ */
+pid_t runCommand(struct cmd_t *cmd, int runInBackground, char *text)
+{
+    char* argv[MAXARGS];
+    int argQuoted[MAXARGS];
+    char* assignments[MAXARGS];
+    char commandName[MAXLINE];
+    int childPid= 0;
+    int i;
+    
+    // expansion rewrites the words, so work on a copy of the parsed ones
+    for (i = 0; i < cmd->argc; i++) {
+        argv[i] = cmd->argv[i];
+        argQuoted[i] = cmd->quoted[i];
+    }
+    argv[i] = NULL;
+    
+    int assignCount = takeAssignments(argv, argQuoted, assignments);
+    int argc = expandVars(argv, argQuoted);
+    if (argc > 0) {
+        argc = expandGlobs(argv, argQuoted);
+    }
+    lastStatus = (argc < 0);
+    if (argc == 0 && assignCount > 0) {
+        // NAME=value on its own sets a shell variable
+        for (i = 0; i < assignCount; i++) {
+            size_t nameLen = strchr(assignments[i], '=') - assignments[i];
+            setvar(assignments[i], nameLen, assignments[i] + nameLen + 1, -1);
+        }
+    }
+    if (argc <= 0) {
+        // blank line, only assignments or expansion error
+        clearLineWords();
+        return 0;
+    }
+    
+    // timeout DURATION cmd runs cmd as a job with a deadline
+    struct timespec timeout = {0, 0};
+    if (!strcmp("timeout", argv[0])) {
+        if (argc < 3 || parseDuration(argv[1], &timeout) < 0) {
+            outPrintf("timeout: usage: timeout DURATION command [arg ...]\n");
+            lastStatus = 2;
+            clearLineWords();
+            return 0;
+        }
+        if (isBuiltin(argv[2])) {
+            // a builtin runs in the shell, there is no job to signal
+            outPrintf("timeout: %s: is a shell builtin\n", argv[2]);
+            lastStatus = 2;
+            clearLineWords();
+            return 0;
+        }
+        if (inSubshell) {
+            // the subshell has no deadline timers, the list as a whole can have one
+            outPrintf("timeout: not in a background list, use bg --deadline\n");
+            lastStatus = 2;
+            clearLineWords();
+            return 0;
+        }
+        argc -= 2;
+        memmove(argv, argv + 2, (argc + 1) * sizeof(char*));
+        memmove(argQuoted, argQuoted + 2, argc * sizeof(int));
+    }
+    strcpy(commandName,argv[0]);
+    // print parsed command to stdout seperated by | ex ls | -v | ./example
+    debugLog("ParsedCommandName = %s\n", commandName);
+    debugLog("Parsed Argument Count = %d\n", argc);
+    
+    if(strcmp("",commandName)){ // strcmp return 0 if equal
+        // check for built in commands
+        if(builtin_cmd(argv, argc)){
+            //outPrintf("%s ran by builtin_cmd not eval\n",commandName);
+            if (strcmp("fg", argv[0]) && strcmp("dag", argv[0])) {
+                lastStatus = 0;
+            }
+        }
+        else{
+            char* iterator = commandName;
+            int absPath = 0;
+            
+            while (*iterator)
+            {
+                if (strchr("/", *iterator))
+                {
+                    // command name contains a slash
+                    absPath = 1;
+                }
+                
+                iterator++;
+            }
+            
+            if (!absPath) {
+                sprintf(commandName, "/bin/%s",argv[0]);
+            }
+            
+            // is process running in the background?
+            if (inSubshell) {
+                // part of a background list: stay in its process group and just wait,
+                // a deadline here belongs on the whole list (bg --deadline)
+                runInSubshell(commandName, argv, assignments, assignCount);
+                clearLineWords();
+                return 0;
+            }
+            
+            // block SIGCHLD to prevent race conditions
+            sigset_t blockListSet;
+            sigemptyset(&blockListSet);
+            sigaddset(&blockListSet, SIGCHLD);
+            sigprocmask(SIG_BLOCK, &blockListSet, NULL);
+            
+            // VAR=value in front of the command only changes its own environment
+            char** envp = assignCount ? overlayEnviron(assignments, assignCount) : exportedEnviron();
+            
+            // the launch hook tries the fork server first, the library forks if that fails
+            flushOutput();
+            record(REC_SPAWN_BEGIN, 0, 0);
+            launchedByServer = 0;
+            struct tsh_job *job = tsh_spawn(&shell, commandName, argv, envp,
+                                            runInBackground ? BG : FG, text);
+            if (!job) {
+                if (errno == ENOSPC) {
+                    outPrintf("Tried to create too many jobs\n");
+                }
+                else {
+                    outPrintf("%s: Could not start: %s\n", commandName, strerror(errno));
+                }
+                sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
+                childPid = -1;
+            }
+            else {
+                childPid = job->pid;
+                record(REC_SPAWN_END, childPid, launchedByServer);
+                debugLog("Started pid %d in pgid %d\n", childPid, job->pgid);
+                if (timeout.tv_sec || timeout.tv_nsec) {
+                    setDeadline(job, &timeout);
+                }
+                // unblock SIGCHLD, waitfg picks up the reap from the event queue
+                sigprocmask(SIG_UNBLOCK, &blockListSet, NULL);
+                if (runInBackground) {
+                    outPrintf("[%d] (%d) %s", job->jid, childPid, text);
+                }
+                else {
+                    waitfg(childPid);
+                }
+            }
+            if (assignCount) {
+                free(envp);
+            }
+        }
+    }
+    
+    clearLineWords();
+    return (childPid > 0) ? childPid : 0;
+}
+/*
+ * getNextPGID - Gets the next unique process group id for a a child process
+ *
+ */
+int getNextPGID(){
+    int tmp = nextPGID;
+    nextPGID = nextPGID + 1;
+    return tmp;
+}
+
+/*****************
+ * Fork server
+ *****************/
+
+/*
+ * startForkServer - Fork the fork server and keep one end of a socketpair
+ *    to talk to it. The server is forked before the shell allocates
+ *    anything so every later fork it does copies a tiny address space.
+ */
+void startForkServer(void)
+{
+    int fds[2];
+    pid_t serverPid;
+    
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        debugLog("socketpair failed, running without fork server\n");
+        forkServerFd = -1;
+        return;
+    }
+    
+    flushOutput();
+    if ((serverPid = fork()) == 0) {
+        // keep out of the terminal's reach: a ctrl-c or ctrl-z meant for
+        // the shell must not kill or stop the server
+        outLen = 0;
+        notifyLen = 0;
+        setpgid(0, 0);
+        Signal(SIGINT, SIG_IGN);
+        Signal(SIGTSTP, SIG_IGN);
+        Signal(SIGQUIT, SIG_IGN);
+        close(fds[0]);
+        forkServerLoop(fds[1]);
+        exit(0);
+    }
+    close(fds[1]);
+    if (serverPid < 0) {
+        close(fds[0]);
+        forkServerFd = -1;
+        return;
+    }
+    
+    // a server that stopped answering must not hang the shell
+    struct timeval timeout = { FSTIMEOUT, 0 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    debugLog("Fork server running as pid %d\n", serverPid);
+    forkServerFd = fds[0];
+    forkServerPid = serverPid;
+}
+
+/*
+ * forkServerLoop - The fork server's main loop
+ *
+ * Each request is a {argc, envc} header followed by the NUL separated
+ * path, argv and environment strings. The child is cloned with
+ * CLONE_PARENT so it is the shell's child (the shell gets its SIGCHLD
+ * and can waitpid it), puts itself in its own process group and execs.
+ * The reply carries the pid and the child's pidfd as SCM_RIGHTS.
+ */
+void forkServerLoop(int fd)
+{
+    static char msg[FSMAXMSG];
+    ssize_t msgSize;
+    
+    while ((msgSize = recv(fd, msg, sizeof(msg), 0)) > 0) {
+        int counts[2];
+        char **strs;
+        char *iterator;
+        int i;
+        int pidfd = -1;
+        pid_t reply[2];
+        
+        if (msgSize < sizeof(counts)) {
+            continue;
+        }
+        memcpy(counts, msg, sizeof(counts));
+        
+        // path, argc args, NULL, envc vars, NULL
+        strs = malloc((counts[0] + counts[1] + 3) * sizeof(char *));
+        iterator = msg + sizeof(counts);
+        for (i = 0; i < counts[0] + counts[1] + 1; i++) {
+            strs[i + (i > counts[0])] = iterator;
+            iterator += strlen(iterator) + 1;
+        }
+        strs[counts[0] + 1] = NULL;
+        strs[counts[0] + counts[1] + 2] = NULL;
+        
+        struct clone_args args;
+        memset(&args, 0, sizeof(args));
+        args.flags = CLONE_PARENT | CLONE_PIDFD;
+        args.pidfd = (unsigned long) &pidfd;
+        
+        reply[0] = syscall(SYS_clone3, &args, sizeof(args));
+        if (reply[0] == 0) {
+            // child process, with the signals the server ignores back to normal
+            setpgid(0, 0);
+            Signal(SIGINT, SIG_DFL);
+            Signal(SIGTSTP, SIG_DFL);
+            Signal(SIGQUIT, SIG_DFL);
+            recordSelf = getpid();
+            record(REC_EXEC, recordSelf, 0);
+            execve(strs[0], strs + 1, strs + counts[0] + 2);
+            
+            // this only runs if execve fails
+            outPrintf("%s: Command Not Found\n",strs[0]);
+            flushOutput();
+            exit(1);
+        }
+        reply[1] = errno;
+        free(strs);
+        
+        // send the pid back with the pidfd attached
+        char control[CMSG_SPACE(sizeof(int))];
+        struct iovec iov = { reply, sizeof(reply) };
+        struct msghdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        if (pidfd >= 0) {
+            struct cmsghdr *cmsg;
+            hdr.msg_control = control;
+            hdr.msg_controllen = sizeof(control);
+            cmsg = CMSG_FIRSTHDR(&hdr);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+            memcpy(CMSG_DATA(cmsg), &pidfd, sizeof(int));
+        }
+        sendmsg(fd, &hdr, MSG_NOSIGNAL);
+        if (pidfd >= 0) {
+            close(pidfd);
+        }
+    }
+}
+
+/*
+ * forkServerSpawn - Ask the fork server to launch path with argv and envp
+ *
+ * Returns the child's pid and stores its pidfd in *pidfd, or returns -1
+ * if the request does not fit in a message or the server is gone or
+ * does not answer within FSTIMEOUT, in which case the caller should
+ * fork the job itself.
+ */
+pid_t forkServerSpawn(char *path, char **argv, char **envp, int *pidfd)
+{
+    static char msg[FSMAXMSG];
+    int counts[2] = {0, 0};
+    size_t msgSize = sizeof(counts);
+    char **strs;
+    int pass;
+    
+    // pack path, argv then envp
+    for (pass = 0; pass < 3; pass++) {
+        strs = (pass == 0) ? &path : (pass == 1) ? argv : envp;
+        while (*strs) {
+            size_t len = strlen(*strs) + 1;
+            if (msgSize + len > sizeof(msg)) {
+                debugLog("Fork server request too large\n");
+                return -1;
+            }
+            memcpy(msg + msgSize, *strs, len);
+            msgSize += len;
+            strs++;
+            if (pass > 0) {
+                counts[pass - 1]++;
+            }
+            if (pass == 0) {
+                break;
+            }
+        }
+    }
+    memcpy(msg, counts, sizeof(counts));
+    
+    if (send(forkServerFd, msg, msgSize, MSG_NOSIGNAL) < 0) {
+        stopForkServer("is gone");
+        return -1;
+    }
+    
+    pid_t reply[2];
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { reply, sizeof(reply) };
+    struct msghdr hdr;
+    struct cmsghdr *cmsg;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof(control);
+    ssize_t replySize;
+    while ((replySize = recvmsg(forkServerFd, &hdr, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    if (replySize < (ssize_t) sizeof(reply)) {
+        stopForkServer((replySize < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ?
+                       "is not answering" : "is gone");
+        return -1;
+    }
+    
+    *pidfd = -1;
+    cmsg = CMSG_FIRSTHDR(&hdr);
+    if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(pidfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (reply[0] < 0) {
+        debugLog("Fork server could not clone: %s\n", strerror(reply[1]));
+    }
+    return reply[0];
+}
+
+/*
+ * stopForkServer - Stop using the fork server and make sure it is gone,
+ *    so a request it has not answered yet can never start a job later
+ */
+void stopForkServer(const char *reason)
+{
+    debugLog("Fork server %s, forking jobs from the shell\n", reason);
+    close(forkServerFd);
+    forkServerFd = -1;
+    if (forkServerPid > 0) {
+        kill(forkServerPid, SIGKILL);
+        forkServerPid = -1;
+    }
+}
+
+/*
+ * parseCommandLine - Parse the command line into a list of commands.
+ *
+ * Words are separated by spaces; characters enclosed in single quotes
+ * are treated as a single word. ; & && and || end a command and say
+ * how it joins the next one. Returns NULL after printing a message if
+ * the line is not valid.
+ */
+struct cmdline_t *parseCommandLine(const char *cmdline)
+{
+    struct cmdline_t *line = malloc(sizeof(struct cmdline_t));
+    struct cmd_t *cmd, **tail = &line->cmds;
+    size_t len = strlen(cmdline);
+    const char *error = NULL;
+    char *buf;
+    int pos = 0;
+    
+    line->src = strdup(cmdline);
+    if (len && line->src[len - 1] == '\n') {
+        line->src[--len] = '\0';
+    }
+    line->buf = buf = strdup(line->src);
+    line->cmds = NULL;
+    
+    cmd = NULL;
+    while (!error) {
+        while (buf[pos] == ' ' || buf[pos] == '\t') /* ignore spaces */
+            pos++;
+        if (!buf[pos]) {
+            break;
+        }
+        
+        if (!cmd) {
+            cmd = calloc(1, sizeof(struct cmd_t));
+            cmd->type = CMD_SIMPLE;
+            cmd->src = line->src;
+            cmd->start = line->cmds ? pos : 0; /* first command keeps leading spaces like before */
+            *tail = cmd;
+            tail = &cmd->next;
+        }
+        
+        if (strchr(";&|", buf[pos])) {
+            // operator: ends the current command
+            int op = buf[pos];
+            int opStart = pos;
+            int end = pos;
+            if (cmd->argc == 0) {
+                error = (op == ';') ? ";" : (buf[pos + 1] == op) ? ((op == '&') ? "&&" : "||") :
+                        (op == '&') ? "&" : "|";
+                break;
+            }
+            if (op != ';' && buf[pos + 1] == op) {
+                cmd->connector = (op == '&') ? CON_AND : CON_OR;
+                pos += 2;
+            }
+            else if (op == '|') {
+                error = "|";
+                break;
+            }
+            else {
+                cmd->connector = (op == '&') ? CON_BG : CON_SEQ;
+                pos++;
+            }
+            while (end > cmd->start && (buf[end - 1] == ' ' || buf[end - 1] == '\t' || !buf[end - 1]))
+                end--;
+            if (cmd->connector == CON_BG) {
+                end = pos;  /* a background job shows its & */
+            }
+            buf[opStart] = '\0';
+            cmd->end = end;
+            cmd = NULL;
+            continue;
+        }
+        
+        if (cmd->argc == MAXARGS - 1) {
+            outPrintf("tsh: too many arguments\n");
+            freeCommandLine(line);
+            return NULL;
+        }
+        if (buf[pos] == '\'') {
+            char *close = strchr(buf + pos + 1, '\'');
+            if (!close) {
+                error = "unterminated quote";
+                break;
+            }
+            cmd->quoted[cmd->argc] = 1;
+            cmd->argv[cmd->argc++] = buf + pos + 1;
+            *close = '\0';
+            pos = close - buf + 1;
+        }
+        else {
+            cmd->quoted[cmd->argc] = 0;
+            cmd->argv[cmd->argc++] = buf + pos;
+            while (buf[pos] && !strchr(" \t;&|", buf[pos]))
+                pos++;
+            if (buf[pos] == ' ' || buf[pos] == '\t') {
+                buf[pos++] = '\0';
+            }
+        }
+        // operators right after a word are handled on the next pass, which ends the word
+    }
+    
+    if (!error && cmd) {
+        // last command runs to the end of the line, trailing spaces and all
+        cmd->end = len;
+    }
+    else if (!error && line->cmds) {
+        // line ended with an operator: fine after ; or &, not after && or ||
+        for (cmd = line->cmds; cmd->next; cmd = cmd->next)
+            ;
+        if (cmd->connector == CON_AND || cmd->connector == CON_OR) {
+            error = "newline";
+        }
+        else {
+            cmd->end = (cmd->connector == CON_BG) ? len : cmd->end;
+        }
+    }
+    
+    if (!error) {
+        // hang loop bodies under their for, while and repeat commands
+        struct cmd_t *flat = line->cmds;
+        line->cmds = groupLoops(&flat, buf, NULL, NULL, &error);
+        freeCmds(flat);
+    }
+    
+    if (error) {
+        outPrintf("tsh: syntax error near %s\n", error);
+        freeCommandLine(line);
+        return NULL;
+    }
+    return line;
+}
+
+/*
+ * groupLoops - Take commands off the front of the flat *list and return
+ *    them as a list where each for, while and repeat is a single command
+ *    holding its body. Stops at a command starting with stopWord, which
+ *    is left in *stopCmd for the caller. Sets *error on a syntax error.
+ */
+struct cmd_t *groupLoops(struct cmd_t **list, char *buf, const char *stopWord,
+                         struct cmd_t **stopCmd, const char **error)
+{
+    struct cmd_t *head = NULL, **tail = &head;
+    struct cmd_t *cmd, *node, *doCmd, *doneCmd;
+    
+    while (!*error && (cmd = *list) != NULL) {
+        *list = cmd->next;
+        cmd->next = NULL;
+        
+        if (stopWord && startsWith(cmd, stopWord)) {
+            *stopCmd = cmd;
+            return head;
+        }
+        if (startsWith(cmd, "do") || startsWith(cmd, "done")) {
+            *error = cmd->argv[0];
+            freeCmds(cmd);
+            break;
+        }
+        
+        node = cmd;
+        if (startsWith(cmd, "for") || startsWith(cmd, "while")) {
+            if (startsWith(cmd, "for")) {
+                // for NAME in WORDS: the command itself becomes the loop
+                snprintf(sbuf, MAXLINE, "%s=", cmd->argc > 1 ? cmd->argv[1] : "");
+                if (cmd->argc < 3 || strcmp(cmd->argv[2], "in") || cmd->quoted[1] || !isAssignment(sbuf)) {
+                    *error = "for";
+                    freeCmds(cmd);
+                    break;
+                }
+                node->type = CMD_FOR;
+                node->var = cmd->argv[1];
+                memmove(node->argv, node->argv + 3, (node->argc - 3) * sizeof(char*));
+                memmove(node->quoted, node->quoted + 3, (node->argc - 3) * sizeof(int));
+                node->argc -= 3;
+                node->argv[node->argc] = NULL;
+            }
+            else {
+                // while COND: the rest of this command starts the condition list
+                if (cmd->argc < 2) {
+                    *error = "while";
+                    freeCmds(cmd);
+                    break;
+                }
+                node = calloc(1, sizeof(struct cmd_t));
+                node->type = CMD_WHILE;
+                node->src = cmd->src;
+                node->start = cmd->start;
+                shiftWords(cmd, 1, buf);
+                cmd->next = *list;
+                *list = cmd;
+                doCmd = NULL;
+                node->cond = groupLoops(list, buf, "do", &doCmd, error);
+                if (doCmd && !node->cond) {
+                    // while do: the condition is empty
+                    *error = "do";
+                    freeCmds(doCmd);
+                    doCmd = NULL;
+                }
+                if (!doCmd) {
+                    freeCmds(node);
+                    break;
+                }
+                // do starts the body, put it back in front of the rest
+                doCmd->next = *list;
+                *list = doCmd;
+            }
+            if (node->type == CMD_FOR) {
+                doCmd = *list;
+                if (!doCmd || !startsWith(doCmd, "do")) {
+                    *error = doCmd ? doCmd->argv[0] : "newline";
+                    freeCmds(node);
+                    break;
+                }
+            }
+            if (doCmd->argc < 2) {
+                *error = "do";
+                freeCmds(node);
+                break;
+            }
+            shiftWords(doCmd, 1, buf);
+            doneCmd = NULL;
+            node->body = groupLoops(list, buf, "done", &doneCmd, error);
+            if (doneCmd && !node->body) {
+                // do done: the body is empty
+                *error = "done";
+            }
+            else if (doneCmd && doneCmd->argc != 1) {
+                *error = doneCmd->argv[1];
+            }
+            if (!doneCmd || *error) {
+                freeCmds(doneCmd);
+                freeCmds(node);
+                break;
+            }
+            // the loop joins the next command the way its done does
+            node->connector = doneCmd->connector;
+            node->end = doneCmd->end;
+            freeCmds(doneCmd);
+        }
+        else if (startsWith(cmd, "repeat")) {
+            // repeat N COMMAND: N stays in the node, the command becomes its body
+            if (cmd->argc < 3) {
+                *error = "repeat";
+                freeCmds(cmd);
+                break;
+            }
+            node = calloc(1, sizeof(struct cmd_t));
+            node->type = CMD_REPEAT;
+            node->src = cmd->src;
+            node->start = cmd->start;
+            node->end = cmd->end;
+            node->connector = cmd->connector;
+            node->argc = 1;
+            node->argv[0] = cmd->argv[1];
+            node->quoted[0] = cmd->quoted[1];
+            shiftWords(cmd, 2, buf);
+            cmd->connector = CON_END;
+            node->body = cmd;
+        }
+        *tail = node;
+        tail = &node->next;
+    }
+    
+    if (!*error && stopWord) {
+        // ran out of commands before the closing word
+        *error = "newline";
+    }
+    return head;
+}
+
+/* startsWith - Is word the unquoted first word of cmd? */
+int startsWith(struct cmd_t *cmd, const char *word)
+{
+    return cmd->type == CMD_SIMPLE && cmd->argc > 0 && !cmd->quoted[0] &&
+           !strcmp(cmd->argv[0], word);
+}
+
+/*
+ * shiftWords - Drop the first count words of cmd, moving its text start
+ *    to the new first word (buf has the same offsets as src)
+ */
+void shiftWords(struct cmd_t *cmd, int count, char *buf)
+{
+    memmove(cmd->argv, cmd->argv + count, (cmd->argc - count) * sizeof(char*));
+    memmove(cmd->quoted, cmd->quoted + count, (cmd->argc - count) * sizeof(int));
+    cmd->argc -= count;
+    cmd->argv[cmd->argc] = NULL;
+    cmd->start = cmd->argv[0] - buf - cmd->quoted[0];
+}
+
+/* freeCmds - Free a command list with the loop bodies under it */
+void freeCmds(struct cmd_t *cmd)
+{
+    struct cmd_t *next;
+    
+    for (; cmd; cmd = next) {
+        next = cmd->next;
+        freeCmds(cmd->cond);
+        freeCmds(cmd->body);
+        free(cmd);
+    }
+}
+
+/* freeCommandLine - Free a parsed command line */
+void freeCommandLine(struct cmdline_t *line)
+{
+    freeCmds(line->cmds);
+    free(line->src);
+    free(line->buf);
+    free(line);
+}
+
+/*****************
+ * Glob expansion
+ *****************/
+
+/*
+ * expandGlobs - Replace unquoted words containing *, ? or [...] by the
+ *    sorted list of paths they match, in place. A pattern that matches
+ *    nothing is left as is. Returns the new argc, or -1 if the result
+ *    does not fit in MAXARGS. quoted is rearranged along with argv.
+ *    Directory listings are cached until clearLineCache so each
+ *    directory is read once per command line.
+ */
+int expandGlobs(char **argv, int *quoted)
+{
+    char *expanded[MAXARGS];
+    int expandedQuoted[MAXARGS];
+    char *matches[MAXARGS];
+    int argc = 0;
+    int i, j, count;
+    
+    for (i = 0; argv[i]; i++) {
+        if (quoted[i] || !hasGlobChars(argv[i])) {
+            if (argc >= MAXARGS - 1) {
+                outPrintf("tsh: too many arguments\n");
+                return -1;
+            }
+            expandedQuoted[argc] = quoted[i];
+            expanded[argc++] = argv[i];
+            continue;
+        }
+        
+        char pattern[MAXLINE];
+        strcpy(pattern, argv[i]);
+        if (pattern[0] == '/') {
+            count = globPath("/", pattern + 1, matches, 0);
+        }
+        else {
+            count = globPath("", pattern, matches, 0);
+        }
+        if (argc + count >= MAXARGS) {
+            outPrintf("tsh: %s: too many arguments\n", argv[i]);
+            for (j = 0; j < count; j++)
+                free(matches[j]);
+            return -1;
+        }
+        if (count == 0) {
+            expandedQuoted[argc] = 0;
+            expanded[argc++] = argv[i];
+            continue;
+        }
+        
+        // each match came from malloc, keep them to free with the line
+        qsort(matches, count, sizeof(char *), compareNames);
+        for (j = 0; j < count; j++) {
+            expandedQuoted[argc] = 0;
+            expanded[argc++] = keepLineWord(matches[j]);
+        }
+    }
+    
+    for (i = 0; i < argc; i++) {
+        argv[i] = expanded[i];
+        quoted[i] = expandedQuoted[i];
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/* hasGlobChars - Does word contain a glob metacharacter */
+int hasGlobChars(const char *word)
+{
+    return strpbrk(word, "*?[") != NULL;
+}
+
+/*
+ * compareNames - qsort helper for directory entry pointers
+ */
+int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/*
+ * globPath - Match pattern (a path relative to dir) one component at a
+ *    time and append the malloc'd matching paths to matches from
+ *    index count on. Returns the new count, which stops at MAXARGS
+ *    if there are too many.
+ */
+int globPath(const char *dir, char *pattern, char **matches, int count)
+{
+    char *slash = strchr(pattern, '/');
+    char *rest = NULL;
+    char path[MAXLINE];
+    int i;
+    
+    if (slash) {
+        *slash = '\0';
+        rest = slash + 1;
+        while (*rest == '/')
+            rest++;
+    }
+    
+    if (!hasGlobChars(pattern)) {
+        // literal component, no need to list the directory
+        if (snprintf(path, MAXLINE, "%s%s", dir, pattern) >= MAXLINE) {
+            // too long to be a path we could exec or pass on
+        }
+        else if (rest && *rest) {
+            strcat(path, "/");
+            count = globPath(path, rest, matches, count);
+        }
+        else if (!access(path, F_OK)) {
+            if (rest) {
+                strcat(path, "/");
+            }
+            if (count < MAXARGS) {
+                matches[count++] = strdup(path);
+            }
+        }
+        if (slash) {
+            *slash = '/';
+        }
+        return count;
+    }
+    
+    struct globdir_t *listing = readGlobDir(dir);
+    if (listing) {
+        listing->busy = 1;
+        // the literal part in front of the first metacharacter is a cheap filter
+        size_t prefixLen = strcspn(pattern, "*?[");
+        
+        for (i = 0; i < listing->count && count < MAXARGS; i++) {
+            char *name = listing->entries[i];
+            if (strncmp(name, pattern, prefixLen)) {
+                continue;
+            }
+            if (name[0] == '.' && pattern[0] != '.') {
+                continue;
+            }
+            if (fnmatch(pattern, name, FNM_PERIOD)) {
+                continue;
+            }
+            if (snprintf(path, MAXLINE, "%s%s", dir, name) >= MAXLINE) {
+                continue;
+            }
+            if (rest && *rest) {
+                strcat(path, "/");
+                count = globPath(path, rest, matches, count);
+            }
+            else {
+                if (rest) {
+                    // trailing slash only matches directories
+                    strcat(path, "/");
+                    if (access(path, F_OK)) {
+                        continue;
+                    }
+                }
+                matches[count++] = strdup(path);
+            }
+        }
+        releaseGlobDir(listing);
+    }
+    
+    if (slash) {
+        *slash = '/';
+    }
+    return count;
+}
+
+/*
+ * readGlobDir - Return the listing of dir, reading it with large
+ *    getdents64 calls the first time it is asked for on this command
+ *    line. A full cache gives up a listing nobody is walking; if all
+ *    of them are busy the listing is read uncached instead.
+ */
+struct globdir_t *readGlobDir(const char *dir)
+{
+    static char *dentBuf = NULL;
+    struct globdir_t *listing = NULL;
+    size_t namesSize = 0, namesCap = 0;
+    int i, fd, capacity = 0;
+    long nread;
+    
+    for (i = 0; i < globDirCount; i++)
+        if (!strcmp(globDirs[i].path, dir))
+            return &globDirs[i];
+    if (!dentBuf && !(dentBuf = malloc(DENTBUFSIZE))) {
+        return NULL;
+    }
+    if ((fd = open(*dir ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0) {
+        return NULL;
+    }
+    
+    if (globDirCount < MAXGLOBDIRS) {
+        listing = &globDirs[globDirCount++];
+    }
+    else {
+        for (i = 0; i < MAXGLOBDIRS && !listing; i++) {
+            if (!globDirs[(globDirNext + i) % MAXGLOBDIRS].busy) {
+                listing = &globDirs[(globDirNext + i) % MAXGLOBDIRS];
+                freeGlobDir(listing);
+            }
+        }
+        globDirNext = (globDirNext + i) % MAXGLOBDIRS;
+    }
+    if (listing) {
+        listing->cached = 1;
+    }
+    else if ((listing = malloc(sizeof(struct globdir_t))) != NULL) {
+        listing->cached = 0;
+    }
+    else {
+        close(fd);
+        return NULL;
+    }
+    listing->busy = 0;
+    listing->path = strdup(dir);
+    listing->names = NULL;
+    listing->entries = NULL;
+    listing->count = 0;
+    
+    while ((nread = syscall(SYS_getdents64, fd, dentBuf, DENTBUFSIZE)) > 0) {
+        long offset = 0;
+        while (offset < nread) {
+            // struct linux_dirent64: ino, off, reclen, type, name
+            char *dent = dentBuf + offset;
+            unsigned short reclen;
+            char *name = dent + 19;
+            size_t len = strlen(name) + 1;
+            memcpy(&reclen, dent + 16, sizeof(reclen));
+            offset += reclen;
+            
+            if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                continue;
+            }
+            if (namesSize + len > namesCap) {
+                namesCap = namesCap ? namesCap * 2 : 65536;
+                listing->names = realloc(listing->names, namesCap);
+            }
+            memcpy(listing->names + namesSize, name, len);
+            namesSize += len;
+            listing->count++;
+        }
+    }
+    close(fd);
+    
+    // names may have moved while growing, so point entries at them at the end
+    capacity = listing->count;
+    listing->entries = malloc((capacity + 1) * sizeof(char *));
+    namesSize = 0;
+    for (i = 0; i < capacity; i++) {
+        listing->entries[i] = listing->names + namesSize;
+        namesSize += strlen(listing->entries[i]) + 1;
+    }
+    return listing;
+}
+
+/* releaseGlobDir - globPath is done walking listing */
+void releaseGlobDir(struct globdir_t *listing)
+{
+    listing->busy = 0;
+    if (!listing->cached) {
+        freeGlobDir(listing);
+        free(listing);
+    }
+}
+
+/* freeGlobDir - Free what a listing holds */
+void freeGlobDir(struct globdir_t *listing)
+{
+    free(listing->path);
+    free(listing->names);
+    free(listing->entries);
+}
+
+/*
+ * keepLineWord - Remember a malloc'd word so clearLineWords frees it
+ *    once the command is done with it
+ */
+char *keepLineWord(char *word)
+{
+    // can't fill up while argv is capped at MAXARGS
+    if (lineWordCount < 2*MAXARGS) {
+        lineWords[lineWordCount++] = word;
+    }
+    return word;
+}
+
+/*
+ * clearLineCache - Forget the listings once the command line is done
+ */
+void clearLineCache(void)
+{
+    int i;
+    
+    for (i = 0; i < globDirCount; i++)
+        freeGlobDir(&globDirs[i]);
+    globDirCount = 0;
+    globDirNext = 0;
+    clearLineWords();
+}
+
+/* clearLineWords - Free the expanded words of the last command */
+void clearLineWords(void)
+{
+    int i;
+    
+    for (i = 0; i < lineWordCount; i++)
+        free(lineWords[i]);
+    lineWordCount = 0;
+}
+
+/*****************
+ * Shell variables
+ *****************/
+
+/* initvars - Start with every environment variable, all exported */
+void initvars(void)
+{
+    char **env;
+    char *equals;
+    
+    for (env = environ; *env; env++) {
+        if ((equals = strchr(*env, '=')) != NULL) {
+            setvar(*env, equals - *env, equals + 1, 1);
+        }
+    }
+}
+
+/* findvar - Find a variable by name, NULL if it is not set */
+struct var_t *findvar(const char *name, size_t nameLen)
+{
+    int i;
+    
+    for (i = 0; i < varCount; i++)
+        if (vars[i].nameLen == nameLen && !strncmp(vars[i].entry, name, nameLen))
+            return &vars[i];
+    return NULL;
+}
+
+/* getvar - Value of a variable, NULL if it is not set */
+char *getvar(const char *name, size_t nameLen)
+{
+    struct var_t *var = findvar(name, nameLen);
+    
+    return var ? var->entry + nameLen + 1 : NULL;
+}
+
+/*
+ * setvar - Set a variable. exported is 1 to export it, 0 to stop
+ *    exporting it or -1 to leave the flag alone (new variables are local)
+ */
+void setvar(const char *name, size_t nameLen, const char *value, int exported)
+{
+    struct var_t *var = findvar(name, nameLen);
+    size_t valueLen = strlen(value);
+    char *entry = malloc(nameLen + valueLen + 2);
+    
+    memcpy(entry, name, nameLen);
+    entry[nameLen] = '=';
+    memcpy(entry + nameLen + 1, value, valueLen + 1);
+    
+    if (!var) {
+        if (varCount == varCapacity) {
+            varCapacity = varCapacity ? varCapacity * 2 : 64;
+            vars = realloc(vars, varCapacity * sizeof(struct var_t));
+        }
+        var = &vars[varCount++];
+        var->entry = NULL;
+        var->nameLen = nameLen;
+        var->exported = 0;
+    }
+    
+    if (var->exported || exported == 1) {
+        // the cached environ points at the old entry
+        free(exportEnv);
+        exportEnv = NULL;
+    }
+    free(var->entry);
+    var->entry = entry;
+    if (exported >= 0) {
+        var->exported = exported;
+    }
+}
+
+/* unsetvar - Remove a variable */
+void unsetvar(const char *name)
+{
+    struct var_t *var = findvar(name, strlen(name));
+    
+    if (!var) {
+        return;
+    }
+    if (var->exported) {
+        free(exportEnv);
+        exportEnv = NULL;
+    }
+    free(var->entry);
+    *var = vars[--varCount];
+}
+
+/* isAssignment - Is word of the form NAME=value */
+int isAssignment(const char *word)
+{
+    const char *iterator = word;
+    
+    if (!isalpha((unsigned char) *iterator) && *iterator != '_') {
+        return 0;
+    }
+    while (isalnum((unsigned char) *iterator) || *iterator == '_')
+        iterator++;
+    return *iterator == '=';
+}
+
+/*
+ * takeAssignments - Move the leading unquoted NAME=value words of argv
+ *    into assignments, with their values expanded. Returns how many.
+ */
+int takeAssignments(char **argv, int *quoted, char **assignments)
+{
+    int count = 0;
+    int i;
+    
+    while (argv[count] && !quoted[count] && isAssignment(argv[count])) {
+        assignments[count] = expandWord(argv[count]);
+        count++;
+    }
+    for (i = 0; argv[i + count]; i++) {
+        argv[i] = argv[i + count];
+        quoted[i] = quoted[i + count];
+    }
+    argv[i] = NULL;
+    return count;
+}
+
+/*
+ * expandVars - Expand $NAME, ${NAME} and $? in the unquoted words of argv.
+ *    A word that expands to nothing is dropped. Returns the new argc.
+ */
+int expandVars(char **argv, int *quoted)
+{
+    int argc = 0;
+    int i;
+    
+    for (i = 0; argv[i]; i++) {
+        char *word = argv[i];
+        if (!quoted[i]) {
+            word = expandWord(word);
+            if (!*word && *argv[i]) {
+                continue;
+            }
+        }
+        quoted[argc] = quoted[i];
+        argv[argc++] = word;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+/*
+ * expandWord - Return word with its variables substituted. Words without
+ *    a $ are returned as is, others in a string freed with the line.
+ */
+char *expandWord(char *word)
+{
+    char result[MAXLINE];
+    size_t len = 0;
+    char *iterator = word;
+    
+    if (!strchr(word, '$')) {
+        return word;
+    }
+    
+    while (*iterator && len < MAXLINE - 1) {
+        const char *name = iterator + 1;
+        size_t nameLen = 0;
+        int braces = (*name == '{');
+        
+        if (*iterator != '$') {
+            result[len++] = *iterator++;
+            continue;
+        }
+        name += braces;
+        if (*name == '?' && (!braces || name[1] == '}')) {
+            // $? is the last exit status
+            len += snprintf(result + len, MAXLINE - len, "%d", lastStatus);
+            if (len > MAXLINE - 1) {
+                len = MAXLINE - 1;
+            }
+            iterator = (char *) name + 1 + braces;
+            continue;
+        }
+        while (isalnum((unsigned char) name[nameLen]) || name[nameLen] == '_')
+            nameLen++;
+        if (!nameLen || isdigit((unsigned char) *name) || (braces && name[nameLen] != '}')) {
+            // not a variable reference, keep the $
+            result[len++] = *iterator++;
+            continue;
+        }
+        
+        char *value = getvar(name, nameLen);
+        if (value) {
+            size_t valueLen = strlen(value);
+            if (valueLen > MAXLINE - 1 - len) {
+                valueLen = MAXLINE - 1 - len;
+            }
+            memcpy(result + len, value, valueLen);
+            len += valueLen;
+        }
+        iterator = (char *) name + nameLen + braces;
+    }
+    result[len] = '\0';
+    return keepLineWord(strdup(result));
+}
+
+/*
+ * exportedEnviron - The environment for execve. It points straight at
+ *    the variable entries and is only rebuilt after an exported
+ *    variable changes.
+ */
+char **exportedEnviron(void)
+{
+    int i, count = 0;
+    
+    if (exportEnv) {
+        return exportEnv;
+    }
+    exportEnv = malloc((varCount + 1) * sizeof(char *));
+    for (i = 0; i < varCount; i++)
+        if (vars[i].exported)
+            exportEnv[count++] = vars[i].entry;
+    exportEnv[count] = NULL;
+    return exportEnv;
+}
+
+/*
+ * overlayEnviron - The environment for a command with NAME=value
+ *    prefixes: a copy of the cached pointer array with those entries
+ *    replaced or added. The strings are shared, the caller frees the array.
+ */
+char **overlayEnviron(char **assignments, int count)
+{
+    char **base = exportedEnviron();
+    char **envp;
+    int baseCount, total, i, j;
+    
+    for (baseCount = 0; base[baseCount]; baseCount++)
+        ;
+    envp = malloc((baseCount + count + 1) * sizeof(char *));
+    memcpy(envp, base, baseCount * sizeof(char *));
+    total = baseCount;
+    
+    for (i = 0; i < count; i++) {
+        size_t nameLen = strchr(assignments[i], '=') - assignments[i] + 1;
+        for (j = 0; j < total; j++)
+            if (!strncmp(envp[j], assignments[i], nameLen))
+                break;
+        envp[j] = assignments[i];
+        if (j == total) {
+            total++;
+        }
+    }
+    envp[total] = NULL;
+    return envp;
+}
+
+/* isBuiltin - Is name a command builtin_cmd runs */
+int isBuiltin(const char *name)
+{
+    static const char *names[] = {
+        "quit", "bg", "fg", "jobs", "kill", "stop", "memguard", "throttle",
+        "dag", "export", "unset", "set",
+    };
+    int i;
+    
+    for (i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+        if (!strcmp(name, names[i]))
+            return 1;
+    return 0;
+}
+
+/*
+ * builtin_cmd - If the user has typed a built-in command then execute
+ *    it immediately.
+ */
+int builtin_cmd(char **argv, int argc)
+{
+    // if it is a bulit in command run it here and return 1
+    // if not retunr 0 to tell eval that it must run it there
+    int ranSomething = 0;
+    if(!strcmp("quit",argv[0])){
+        debugLog(("Running Quit in builtin_cmd\n"));
+        // kill all process in jobs list befre dying
+        terminateAllUnexitedJobs(jobs);
+        flushNotifications("");
+        exit(0);
+        
+    }
+    else if(!strcmp("bg",argv[0])){
+        debugLog("Ran bg\n");
+        do_bgfg(argv,argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("fg",argv[0])){
+        debugLog("ran fg\n");
+        do_bgfg(argv,argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("jobs",argv[0])){
+        if (argc > 1 && !strcmp(argv[1], "-l"))
+            listjobsLong(jobs);
+        else
+            listjobs(jobs);
+        ranSomething = 1;
+    }
+    else if(!strcmp("kill",argv[0]) || !strcmp("stop",argv[0])){
+        do_signalJobs(argv, argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("memguard",argv[0])){
+        do_memguard(argv, argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("throttle",argv[0])){
+        do_throttle(argv, argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("dag",argv[0])){
+        do_dag(argv, argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("export",argv[0])){
+        do_export(argv, argc);
+        ranSomething = 1;
+    }
+    else if(!strcmp("unset",argv[0])){
+        int i;
+        for (i = 1; i < argc; i++)
+            unsetvar(argv[i]);
+        ranSomething = 1;
+    }
+    else if(!strcmp("set",argv[0])){
+        // set -b reports background jobs right away, set +b waits for the prompt
+        if (argc == 1) {
+            int i;
+            for (i = 0; i < varCount; i++)
+                outPrintf("%s\n", vars[i].entry);
+        }
+        else if (argc == 2 && !strcmp("-b", argv[1])) {
+            notifyNow = 1;
+        }
+        else if (argc == 2 && !strcmp("+b", argv[1])) {
+            notifyNow = 0;
+        }
+        else {
+            outPrintf("set: usage: set [-b | +b]\n");
+        }
+        ranSomething = 1;
+    }
+    
+    return ranSomething;     /* not a builtin command */
+}
+
+/*
+ * do_export - Execute the builtin export command
+ *    export             list the exported variables
+ *    export NAME        export an existing (or empty) variable
+ *    export NAME=value  set and export
+ */
+void do_export(char **argv, int argc)
+{
+    int i;
+    
+    if (argc == 1) {
+        for (i = 0; i < varCount; i++)
+            if (vars[i].exported)
+                outPrintf("export %s\n", vars[i].entry);
+        return;
+    }
+    
+    for (i = 1; i < argc; i++) {
+        char *equals = strchr(argv[i], '=');
+        size_t nameLen = equals ? equals - argv[i] : strlen(argv[i]);
+        char *value;
+        
+        snprintf(sbuf, MAXLINE, "%.*s=", (int) nameLen, argv[i]);
+        if (!isAssignment(sbuf)) {
+            outPrintf("export: %s: not a valid identifier\n", argv[i]);
+            continue;
+        }
+        value = equals ? equals + 1 : getvar(argv[i], nameLen);
+        setvar(argv[i], nameLen, value ? value : "", 1);
+    }
+}
+
+/*
+ * do_bgfg - Execute the builtin bg and fg commands. fg takes one job,
+ *    bg continues every stopped job its selectors pick (see selectJobs)
+ * #define FG 1
+ * #define BG 2
+ * #define ST 3
+ */
+void do_bgfg(char **argv, int argc)
+{
+    char commandName[MAXLINE];
+    strcpy(commandName, argv[0]);
+    struct timespec deadline = {0, 0};
+    
+    // bg --deadline DURATION job also gives the job a time limit
+    if (!strcmp("bg", commandName) && argc >= 2 && !strcmp("--deadline", argv[1])) {
+        if (argc < 4 || parseDuration(argv[2], &deadline) < 0) {
+            outPrintf("bg: usage: bg [--deadline DURATION] PID|%%jobid\n");
+            return;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    
+    if (argc < 2) {
+        outPrintf("%s command requires PID or %%jobid argument\n", commandName);
+        return;
+    }
+    
+    struct tsh_job* selected[MAXJOBS];
+    int count = selectJobs(argv + 1, argc - 1, commandName, selected);
+    if (count < 0) {
+        return;
+    }
+    if (!strcmp("fg", commandName) && (argc > 2 || count != 1)) {
+        outPrintf("fg: %s: %s\n", argv[1], count ? "more than one job" : "no such job");
+        return;
+    }
+    if (!strcmp("bg", commandName)) {
+        // every selected job in one pass
+        int i;
+        for (i = 0; i < count; i++) {
+            if (deadline.tv_sec || deadline.tv_nsec) {
+                setDeadline(selected[i], &deadline);
+            }
+            if (selected[i]->state == ST) {
+                outPrintf("[%d] (%d) %s", selected[i]->jid, selected[i]->pid, selected[i]->cmdline);
+            }
+            jobinfo(selected[i])->memStopped = 0;
+            tsh_bg(&shell, selected[i]);
+        }
+        return;
+    }
+    
+    int jidToStateChange;
+    struct tsh_job* jobToChange = selected[0];
+    pid_t pidToStateChange;
+    
+    assert(jobToChange && "There must be a job to fg/bg");
+    pidToStateChange = jobToChange->pid;
+    jidToStateChange = jobToChange->jid;
+    jobinfo(jobToChange)->memStopped = 0;
+    
+    debugLog("%sing (%d) from previous state %d\n",commandName,jidToStateChange,jobToChange->state);
+    
+    if (!strcmp("fg", commandName)) {
+        // foreground process
+        
+        if (jobToChange->state != FG) {
+            // libtsh continues it if it is stopped, another FG job would be a bug
+            int result = tsh_fg(&shell, jobToChange);
+            assert((result == 0) && "There can only be one FG job");
+            debugLog("[%d] (%d) %s", jidToStateChange, pidToStateChange, jobToChange->cmdline);
+            waitfg(pidToStateChange);
+        }
+    }
+    
+    return;
+}
+
+/*
+ * selectJobs - Resolve job selectors to the jobs they pick, in one pass
+ *    over the job list with each job picked at most once:
+ *        N          the job with process ID N
+ *        %N         job N
+ *        %N-%M      jobs N through M (the second % is optional)
+ *        %stopped   every stopped job
+ *        %running   every running background job
+ *        %?text     every job whose command line contains text
+ *    Fills selected in job list order and returns how many, or -1 after
+ *    printing a message for a selector that is bad or names no job.
+ */
+int selectJobs(char **args, int count, const char *commandName, struct tsh_job **selected)
+{
+    int picked[MAXJOBS] = {0};
+    int i, j, found, total = 0;
+    
+    for (i = 0; i < count; i++) {
+        char *sel = args[i] + 1;
+        long low = 0, high = 0;
+        char *end;
+        
+        if (args[i][0] != '%') {
+            // only a PID may be given without %, letters are not allowed
+            if (hasDisallowedChars(args[i])) {
+                outPrintf("%s: argument must be a PID or %%jobid\n", commandName);
+                return -1;
+            }
+            low = atoi(args[i]);
+            for (j = 0, found = 0; j < MAXJOBS; j++)
+                if (jobs[j].pid != 0 && jobs[j].pid == low)
+                    found = picked[j] = 1;
+            if (!found) {
+                outPrintf("%s: %s: no such process\n", commandName, args[i]);
+                return -1;
+            }
+            continue;
+        }
+        
+        if (!strcmp(sel, "stopped") || !strcmp(sel, "running")) {
+            int state = (sel[0] == 's') ? ST : BG;
+            for (j = 0; j < MAXJOBS; j++)
+                if (jobs[j].pid != 0 && jobs[j].state == state)
+                    picked[j] = 1;
+            continue;
+        }
+        if (sel[0] == '?' && sel[1]) {
+            for (j = 0; j < MAXJOBS; j++)
+                if (jobs[j].pid != 0 && strstr(jobs[j].cmdline, sel + 1))
+                    picked[j] = 1;
+            continue;
+        }
+        
+        // %N or %N-%M
+        low = high = strtol(sel, &end, 10);
+        if (end != sel && *end == '-') {
+            sel = end + 1 + (end[1] == '%');
+            high = strtol(sel, &end, 10);
+        }
+        if (end == sel || *end || !isdigit((unsigned char) args[i][1])) {
+            outPrintf("%s: argument must be a PID or %%jobid\n", commandName);
+            return -1;
+        }
+        for (j = 0, found = 0; j < MAXJOBS; j++)
+            if (jobs[j].pid != 0 && jobs[j].jid >= low && jobs[j].jid <= high)
+                found = picked[j] = 1;
+        if (!found) {
+            outPrintf("%s: %s: no such job\n", commandName, args[i]);
+            return -1;
+        }
+    }
+    
+    for (j = 0; j < MAXJOBS; j++)
+        if (picked[j])
+            selected[total++] = &jobs[j];
+    return total;
+}
+
+/*
+ * do_signalJobs - Execute the builtin kill and stop commands
+ *    kill [-SIGNAL] SELECTOR ...   signal every selected job (default TERM)
+ *    stop SELECTOR ...             stop every selected job
+ */
+void do_signalJobs(char **argv, int argc)
+{
+    static const struct { const char *name; int sig; } names[] = {
+        { "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT }, { "KILL", SIGKILL },
+        { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 }, { "TERM", SIGTERM }, { "CONT", SIGCONT },
+        { "STOP", SIGSTOP }, { "TSTP", SIGTSTP },
+    };
+    struct tsh_job* selected[MAXJOBS];
+    int sig = strcmp("stop", argv[0]) ? SIGTERM : SIGSTOP;
+    int first = 1, count, i;
+    
+    if (sig == SIGTERM && argc > 1 && argv[1][0] == '-') {
+        char *name = argv[1] + 1;
+        if (!strncmp(name, "SIG", 3))
+            name += 3;
+        sig = isdigit((unsigned char) *name) ? atoi(name) : 0;
+        for (i = 0; !sig && i < (int)(sizeof(names) / sizeof(names[0])); i++)
+            if (!strcmp(name, names[i].name))
+                sig = names[i].sig;
+        if (sig <= 0 || sig >= NSIG) {
+            outPrintf("kill: %s: invalid signal\n", argv[1]);
+            return;
+        }
+        first = 2;
+    }
+    if (argc <= first) {
+        outPrintf("%s command requires PID or %%jobid argument\n", argv[0]);
+        return;
+    }
+    
+    // a throttled job's SIGSTOP reports are ignored, so take it off the throttle first
+    sigset_t blockListSet, prevSet;
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+    drainEvents();
+    if ((count = selectJobs(argv + first, argc - first, argv[0], selected)) < 0) {
+        sigprocmask(SIG_SETMASK, &prevSet, NULL);
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        if ((sig == SIGSTOP || sig == SIGTSTP) && jobinfo(selected[i])->throttle) {
+            unthrottleJob(selected[i]);
+        }
+        // the user takes over from memguard
+        jobinfo(selected[i])->memStopped = 0;
+        debugLog("Sending signal %d to job [%d]\n", sig, selected[i]->jid);
+        // libtsh also continues a stopped job so it acts on the signal
+        if (tsh_signal(&shell, selected[i], sig) < 0) {
+            continue;
+        }
+        // the stop report comes later, the rest of the line sees the state now
+        if (sig == SIGSTOP || sig == SIGTSTP || sig == SIGTTIN || sig == SIGTTOU) {
+            tsh_setstate(&shell, selected[i], ST);
+        }
+        else if (sig == SIGCONT && selected[i]->state == ST) {
+            tsh_setstate(&shell, selected[i], BG);
+        }
+    }
+    sigprocmask(SIG_SETMASK, &prevSet, NULL);
+}
+
+/*
+ * testForChars(char* tmp) test if there are any of the disallowed chars in tmp
+ *
+ */
+int hasDisallowedChars(char* tmp){
+    const char *disallowedChars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char *iterator = tmp;
+    while (*iterator)
+    {
+        if (strchr(disallowedChars, *iterator))
+            return 1;
+        
+        iterator++;
+    }
+    return 0;
+}
+
+/*
+ * waitfg - Block until process pid is no longer the foreground process based on job list
+ *
+ * The handlers only queue events, so sleep in ppoll with the signals
+ * unblocked like sigsuspend and drain the queue each time a signal wakes
+ * us up until the job has been reaped or stopped. The deadline timerfd
+ * is polled too so a foreground job's timeout fires.
+ */
+void waitfg(pid_t pid){
+    sigset_t blockListSet, prevSet;
+    struct tsh_job* job;
+    
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigaddset(&blockListSet, SIGINT);
+    sigaddset(&blockListSet, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+    record(REC_WAIT_BEGIN, pid, 0);
+    
+    while (1) {
+        drainEvents();
+        job = tsh_getjobpid(&shell, pid);
+        if (!job || job->state != FG) {
+            break;
+        }
+        flushOutput();
+        pollTimers(-1, &prevSet);
+    }
+    
+    record(REC_WAIT_END, pid, 0);
+    sigprocmask(SIG_SETMASK, &prevSet, NULL);
+    return;
+}
+
+/*********************
+ * Signal event queue
+ *********************/
+
+/* initevents - Number the queue slots so the first lap is free */
+void initevents(void)
+{
+    unsigned int i;
+    
+    for (i = 0; i < MAXEVENTS; i++)
+        atomic_init(&eventQueue[i].seq, i);
+    atomic_init(&eventTail, 0);
+    eventHead = 0;
+}
+
+/*
+ * reserveEvent - Claim the next free slot, NULL if the queue is full.
+ *    Async-signal-safe.
+ */
+struct event_t *reserveEvent(unsigned int *pos)
+{
+    struct event_t *event;
+    unsigned int tail = atomic_load_explicit(&eventTail, memory_order_relaxed);
+    
+    while (1) {
+        event = &eventQueue[tail & (MAXEVENTS - 1)];
+        int diff = (int) (atomic_load_explicit(&event->seq, memory_order_acquire) - tail);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&eventTail, &tail, tail + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *pos = tail;
+                event->kind = EV_NONE;
+                clock_gettime(CLOCK_MONOTONIC, &event->when);
+                return event;
+            }
+        }
+        else if (diff < 0) {
+            return NULL;
+        }
+        else {
+            tail = atomic_load_explicit(&eventTail, memory_order_relaxed);
+        }
+    }
+}
+
+/* publishEvent - Hand a filled in slot over to the main loop */
+void publishEvent(struct event_t *event, unsigned int pos)
+{
+    atomic_store_explicit(&event->seq, pos + 1, memory_order_release);
+}
+
+/* pushEvent - Queue an event with no payload. Async-signal-safe. */
+void pushEvent(int kind)
+{
+    unsigned int pos;
+    struct event_t *event = reserveEvent(&pos);
+    
+    if (event) {
+        event->kind = kind;
+        publishEvent(event, pos);
+    }
+}
+
+/*
+ * drainEvents - Apply every queued event in order. Only the main loop
+ *    calls this. If the queue overflowed, SIGCHLD stopped reaping, so
+ *    run the reaper again once there is room.
+ */
+void drainEvents(void)
+{
+    struct event_t event;
+    struct event_t *slot;
+    
+    while (1) {
+        slot = &eventQueue[eventHead & (MAXEVENTS - 1)];
+        if (atomic_load_explicit(&slot->seq, memory_order_acquire) != eventHead + 1) {
+            if (eventsOverflowed) {
+                eventsOverflowed = 0;
+                sigchld_handler(SIGCHLD);
+                continue;
+            }
+            tsh_sweep(&shell);
+            break;
+        }
+        event.kind = slot->kind;
+        event.pid = slot->pid;
+        event.pgid = slot->pgid;
+        event.status = slot->status;
+        event.cpuUsec = slot->cpuUsec;
+        event.maxrssKB = slot->maxrssKB;
+        event.when = slot->when;
+        atomic_store_explicit(&slot->seq, eventHead + MAXEVENTS, memory_order_release);
+        eventHead++;
+        handleEvent(&event);
+    }
+}
+
+/*
+ * handleEvent - Do the job list changes and output for one signal event
+ */
+void handleEvent(struct event_t *event)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (event->kind != EV_NONE) {
+        record(REC_EVENT, event->pid, event->kind);
+    }
+    debugLog("Event %d queued %ld us ago\n", event->kind,
+             (now.tv_sec - event->when.tv_sec) * 1000000 + (now.tv_nsec - event->when.tv_nsec) / 1000);
+    
+    if (event->kind == EV_CHILD) {
+        int returnedStatus = event->status;
+        pid_t signalingPID = event->pid;
+        struct tsh_job* job = tsh_getjobpid(&shell, signalingPID);
+        debugLog("SIGCHLD recieved from pid: %d\n", signalingPID);
+        
+        if (!job) {
+            // not a job leader: one of a job's descendants that was reparented to us
+            job = tsh_getjobpgid(&shell, event->pgid);
+            if (job && !WIFSTOPPED(returnedStatus)) {
+                tsh_account(job, signalingPID, event->cpuUsec, event->maxrssKB);
+                debugLog("Reaped descendant %d of job [%d]\n", signalingPID, job->jid);
+            }
+            return;
+        }
+        if (WIFSTOPPED(returnedStatus) && WSTOPSIG(returnedStatus) == SIGSTOP &&
+            (jobinfo(job)->throttle || jobinfo(job)->memStopped)) {
+            // the throttle pausing it or memguard's stop, which it already reported
+            return;
+        }
+        if (!WIFSTOPPED(returnedStatus)) {
+            // the leader's usage covers the children it waited for itself
+            tsh_account(job, signalingPID, event->cpuUsec, event->maxrssKB);
+        }
+        
+        if (signalingPID == tsh_fgpid(&shell)) {
+            // the foreground job's status is what && || and $? see
+            lastStatus = WIFEXITED(returnedStatus) ? WEXITSTATUS(returnedStatus) :
+                         WIFSIGNALED(returnedStatus) ? 128 + WTERMSIG(returnedStatus) :
+                         128 + WSTOPSIG(returnedStatus);
+            if (jobinfo(job)->timedOut && !WIFSTOPPED(returnedStatus)) {
+                // like timeout(1)
+                lastStatus = 124;
+            }
+        }
+        
+        if (WIFEXITED(returnedStatus)){
+            // process terminated by exit clean up child by killig it
+            debugLog("Child %d terminated with exit status %d\n", signalingPID, WEXITSTATUS(returnedStatus));
+            dagJobDone(signalingPID, returnedStatus);
+            retireJob(job);
+        }
+        else if(WIFSIGNALED(returnedStatus)){
+            // terminated by a signal, the foreground job is reported right away
+            int signal = WTERMSIG(returnedStatus);
+            if (signalingPID == tsh_fgpid(&shell)) {
+                outPrintf("Job [%d] (%d) terminated by signal %d\n",tsh_pid2jid(&shell, signalingPID),signalingPID,signal);
+            }
+            else {
+                notify("Job [%d] (%d) terminated by signal %d\n",tsh_pid2jid(&shell, signalingPID),signalingPID,signal);
+            }
+            dagJobDone(signalingPID, returnedStatus);
+            retireJob(job);
+        }
+        else if (WIFSTOPPED(returnedStatus)){
+            if (job->state == FG) {
+                outPrintf("Job [%d] (%d) stopped by signal %d\n", job->jid, signalingPID, WSTOPSIG(returnedStatus));
+            }
+            else {
+                notify("Job [%d] (%d) stopped by signal %d\n", job->jid, signalingPID, WSTOPSIG(returnedStatus));
+            }
+            tsh_setstate(&shell, job, ST);
+        }
+        else{
+            debugLog("Child %d terminated wierdly\n", signalingPID);
+        }
+    }
+    else if (event->kind == EV_INT || event->kind == EV_TSTP) {
+        int sig = (event->kind == EV_INT) ? SIGINT : SIGTSTP;
+        outPrintf("\n");
+        debugLog("User Pressed %s\n", (sig == SIGINT) ? "ctrl-c" : "ctrl-z");
+        
+        pid_t fgPID = tsh_fgpid(&shell);
+        debugLog("fgPID = %d\n",fgPID);
+        if (fgPID > 0) {
+            // we want to send the signal to all process in fgPID's process group
+            killpg(tsh_getjobpid(&shell, fgPID)->pgid, sig);
+            if (sig == SIGINT) {
+                // ctrl-c abandons the rest of the command line like other shells
+                lineInterrupted = 1;
+            }
+            debugLog("Forwarded signal %d to pid: %d\n", sig, fgPID);
+        }
+        else if (dagRunning && sig == SIGINT) {
+            // the dag builtin stands in for a foreground job
+            lineInterrupted = 1;
+        }
+        else if (lineRunning && sig == SIGINT) {
+            // builtins only, like a loop of them: stop the rest of the line
+            debugLog("No fg process, interrupting the line\n");
+            lineInterrupted = 1;
+            lastStatus = 128 + SIGINT;
+        }
+        else{
+            debugLog("No fg process ignoring signal %d\n", sig);
+            if (emit_prompt) {
+                outPrintf("%s",prompt);
+            }
+        }
+    }
+}
+
+/*
+ * retireJob - The job's leader is gone: libtsh keeps the job, in the
+ *    background, while others in its group run on, and deletes it
+ *    once they are all gone too. tsh_sweep after each drain checks.
+ */
+void retireJob(struct tsh_job *job)
+{
+    if (tsh_retire(&shell, job) != UNDEF) {
+        debugLog("Job [%d] (%d) exited, keeping it for the rest of pgid %d\n",
+                 job->jid, job->pid, job->pgid);
+    }
+}
+
+/*****************
+ * Event recorder
+ *****************/
+
+/*
+ * initrecorder - Map the shared record ring. With a path the ring is
+ *    also dumped there when the shell exits, SIGUSR1 dumps it to the
+ *    path or to /tmp/tsh.PID.trace. Convert dumps with tracejson.pl.
+ */
+void initrecorder(const char *path)
+{
+    shellPid = recordSelf = getpid();
+    recorder = mmap(NULL, sizeof(struct recorder_t), PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (recorder == MAP_FAILED) {
+        debugLog("Could not map the event recorder: %s\n", strerror(errno));
+        recorder = NULL;
+        return;
+    }
+    atomic_init(&recorder->next, 0);
+    if (path) {
+        snprintf(recordPath, sizeof(recordPath), "%s", path);
+        atexit(dumpRecords);
+    }
+    else {
+        snprintf(recordPath, sizeof(recordPath), "/tmp/tsh.%d.trace", shellPid);
+    }
+}
+
+/* record - Append a record to the ring. Async-signal-safe. */
+void record(int kind, pid_t pid, int arg)
+{
+    struct timespec now;
+    struct record_t *rec;
+    
+    if (!recorder) {
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    rec = &recorder->records[atomic_fetch_add_explicit(&recorder->next, 1, memory_order_relaxed)
+                             & (MAXRECORDS - 1)];
+    rec->ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    rec->kind = kind;
+    rec->self = recordSelf;
+    rec->pid = pid;
+    rec->arg = arg;
+}
+
+/*
+ * dumpRecords - Write the ring to recordPath, oldest record first,
+ *    after a header of "TSHTRACE", the record size and count as
+ *    uint32, the number of older records overwritten as uint64 and
+ *    the shell's pid padded to 8 bytes.
+ *    Only uses write(2), so SIGUSR1 can dump from the handler even
+ *    when the main loop is stuck.
+ */
+void dumpRecords(void)
+{
+    struct { char magic[8]; uint32_t size, count; uint64_t lost; uint32_t pid, pad; } header;
+    unsigned long total, first;
+    int fd;
+    
+    if (!recorder || getpid() != shellPid) {
+        // a forked copy of the shell exiting, the ring is the shell's to dump
+        return;
+    }
+    record(REC_DUMP, 0, (int) atomic_load(&recorder->next));
+    total = atomic_load(&recorder->next);
+    first = (total > MAXRECORDS) ? total - MAXRECORDS : 0;
+    
+    memcpy(header.magic, "TSHTRACE", 8);
+    header.size = sizeof(struct record_t);
+    header.count = total - first;
+    header.lost = first;
+    header.pid = shellPid;
+    header.pad = 0;
+    if ((fd = open(recordPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+        return;
+    }
+    struct iovec vec[3] = {
+        { &header, sizeof(header) },
+        { &recorder->records[first & (MAXRECORDS - 1)],
+          (MAXRECORDS - (first & (MAXRECORDS - 1))) * sizeof(struct record_t) },
+        { recorder->records, (first & (MAXRECORDS - 1)) * sizeof(struct record_t) },
+    };
+    if (total < MAXRECORDS) {
+        vec[1].iov_len = total * sizeof(struct record_t);
+    }
+    writev(fd, vec, 3);
+    close(fd);
+}
+
+/* sigusr1_handler - Dump the event recorder */
+void sigusr1_handler(int sig)
+{
+    int savedErrno = errno;
+    
+    dumpRecords();
+    errno = savedErrno;
+}
+
+/*****************
+ * Shell output
+ *****************/
+
+/* outPrintf - printf into the shell's output batch */
+int outPrintf(const char *format, ...)
+{
+    va_list args;
+    int len;
+    
+    va_start(args, format);
+    len = vOutPrintf(format, args);
+    va_end(args);
+    return len;
+}
+
+/* vOutPrintf - vprintf into the shell's output batch */
+int vOutPrintf(const char *format, va_list args)
+{
+    va_list again;
+    int len;
+    
+    va_copy(again, args);
+    len = vsnprintf(outBuf + outLen, MAXOUTPUT - outLen, format, args);
+    if (len >= (int)(MAXOUTPUT - outLen)) {
+        // no room left, send what we have and format it again
+        flushOutput();
+        len = vsnprintf(outBuf, MAXOUTPUT, format, again);
+        if (len >= MAXOUTPUT) {
+            len = MAXOUTPUT - 1;
+        }
+    }
+    va_end(again);
+    if (len > 0) {
+        outLen += len;
+    }
+    return len;
+}
+
+/* flushOutput - Write the pending output, notifications stay queued */
+void flushOutput(void)
+{
+    struct iovec vec;
+    
+    if (outLen == 0) {
+        return;
+    }
+    vec.iov_base = outBuf;
+    vec.iov_len = outLen;
+    writeOut(&vec, 1);
+    outLen = 0;
+}
+
+/* writeOut - writev all of vec to stdout, picking up after short writes */
+void writeOut(struct iovec *vec, int count)
+{
+    ssize_t n;
+    
+    while (count > 0) {
+        if (vec->iov_len == 0) {
+            vec++;
+            count--;
+            continue;
+        }
+        if ((n = writev(STDOUT_FILENO, vec, count)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        while (count > 0 && (size_t)n >= vec->iov_len) {
+            n -= vec->iov_len;
+            vec++;
+            count--;
+        }
+        if (count > 0) {
+            vec->iov_base = (char *)vec->iov_base + n;
+            vec->iov_len -= n;
+        }
+    }
+}
+
+/*********************
+ * Job notifications
+ *********************/
+
+/*
+ * notify - Report a background job state change at the next prompt,
+ *    or now if set -b is on
+ */
+void notify(const char *format, ...)
+{
+    va_list args;
+    int len;
+    
+    va_start(args, format);
+    if (notifyNow) {
+        vOutPrintf(format, args);
+        va_end(args);
+        return;
+    }
+    len = vsnprintf(notifyBuf + notifyLen, MAXNOTIFY - notifyLen, format, args);
+    va_end(args);
+    
+    if (len >= MAXNOTIFY - notifyLen) {
+        // no room left, send what we have and queue this one again
+        notifyBuf[notifyLen] = '\0';
+        flushNotifications("");
+        va_start(args, format);
+        len = vsnprintf(notifyBuf, MAXNOTIFY, format, args);
+        va_end(args);
+        if (len >= MAXNOTIFY) {
+            len = MAXNOTIFY - 1;
+        }
+    }
+    notifyLen += len;
+}
+
+/*
+ * flushNotifications - Write the pending output and notifications
+ *    followed by trailer (the prompt) with a single writev
+ */
+void flushNotifications(const char *trailer)
+{
+    struct iovec vec[3];
+    
+    vec[0].iov_base = outBuf;
+    vec[0].iov_len = outLen;
+    vec[1].iov_base = notifyBuf;
+    vec[1].iov_len = notifyLen;
+    vec[2].iov_base = (char *)trailer;
+    vec[2].iov_len = strlen(trailer);
+    writeOut(vec, 3);
+    outLen = 0;
+    notifyLen = 0;
+}
+
+/*****************
+ * Deadline timers
+ *****************/
+
+/* inittimers - Create the timerfd that fires for the earliest deadline */
+void inittimers(void)
+{
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd < 0)
+        unix_error("timerfd_create error");
+}
+
+/*
+ * parseDuration - Parse a duration like 10, 2.5s, 100ms, 5m or 1h.
+ *    Returns 0, or -1 if text isn't a positive duration.
+ */
+int parseDuration(const char *text, struct timespec *duration)
+{
+    char *end;
+    double seconds = strtod(text, &end);
+    
+    if (end == text || !(seconds > 0)) {
+        return -1;
+    }
+    if (!strcmp(end, "ms")) {
+        seconds /= 1000;
+    }
+    else if (!strcmp(end, "m")) {
+        seconds *= 60;
+    }
+    else if (!strcmp(end, "h")) {
+        seconds *= 3600;
+    }
+    else if (*end && strcmp(end, "s")) {
+        return -1;
+    }
+    duration->tv_sec = (time_t)seconds;
+    duration->tv_nsec = (long)((seconds - duration->tv_sec) * 1000000000);
+    return 0;
+}
+
+/*
+ * setDeadline - Give job a time limit duration from now, replacing any
+ *    earlier one
+ */
+void setDeadline(struct tsh_job *job, const struct timespec *duration)
+{
+    struct jobinfo_t *info = jobinfo(job);
+    
+    clock_gettime(CLOCK_MONOTONIC, &info->deadline);
+    info->deadline.tv_sec += duration->tv_sec;
+    info->deadline.tv_nsec += duration->tv_nsec;
+    if (info->deadline.tv_nsec >= 1000000000) {
+        info->deadline.tv_sec++;
+        info->deadline.tv_nsec -= 1000000000;
+    }
+    info->timedOut = 0;
+    addAlarm(info->deadline, job->pid, AL_TERM);
+    debugLog("Job [%d] deadline in %ld.%09lds\n", job->jid, (long)duration->tv_sec, duration->tv_nsec);
+}
+
+/* alarmBefore - Does a come due before b? */
+int alarmBefore(const struct alarm_t *a, const struct alarm_t *b)
+{
+    if (a->when.tv_sec != b->when.tv_sec)
+        return a->when.tv_sec < b->when.tv_sec;
+    return a->when.tv_nsec < b->when.tv_nsec;
+}
+
+/* addAlarm - Put a timer on the heap and rearm if it is the new earliest */
+void addAlarm(struct timespec when, pid_t pid, int kind)
+{
+    struct alarm_t tmp;
+    int i, parent;
+    
+    if (alarmCount == MAXALARMS) {
+        purgeAlarms();
+        if (alarmCount == MAXALARMS) {
+            outPrintf("tsh: too many deadlines\n");
+            return;
+        }
+    }
+    i = alarmCount++;
+    alarms[i].when = when;
+    alarms[i].pid = pid;
+    alarms[i].kind = kind;
+    while (i > 0 && alarmBefore(&alarms[i], &alarms[parent = (i - 1) / 2])) {
+        tmp = alarms[i];
+        alarms[i] = alarms[parent];
+        alarms[parent] = tmp;
+        i = parent;
+    }
+    if (i == 0) {
+        armTimer();
+    }
+}
+
+/* popAlarm - Take the earliest timer off the heap */
+struct alarm_t popAlarm(void)
+{
+    struct alarm_t top = alarms[0];
+    struct alarm_t tmp;
+    int i = 0, child;
+    
+    alarms[0] = alarms[--alarmCount];
+    while ((child = 2 * i + 1) < alarmCount) {
+        if (child + 1 < alarmCount && alarmBefore(&alarms[child + 1], &alarms[child]))
+            child++;
+        if (!alarmBefore(&alarms[child], &alarms[i]))
+            break;
+        tmp = alarms[i];
+        alarms[i] = alarms[child];
+        alarms[child] = tmp;
+        i = child;
+    }
+    return top;
+}
+
+/*
+ * purgeAlarms - Drop the timers of jobs that are gone and rebuild the
+ *    heap, for when it fills up with stale entries. The live ones are
+ *    packed to the front in place, then pushed back on one by one:
+ *    the heap never reaches past the entry being pushed.
+ */
+void purgeAlarms(void)
+{
+    struct tsh_job *job;
+    struct jobinfo_t *info;
+    struct alarm_t live;
+    int i, count = 0;
+    
+    for (i = 0; i < alarmCount; i++) {
+        job = tsh_getjobpid(&shell, alarms[i].pid);
+        info = job ? jobinfo(job) : NULL;
+        if (alarms[i].kind == AL_MEMCHECK) {
+            if (alarms[i].when.tv_sec == memCheckNext.tv_sec && alarms[i].when.tv_nsec == memCheckNext.tv_nsec)
+                alarms[count++] = alarms[i];
+        }
+        else if (job &&
+            (alarms[i].kind == AL_KILL ? info->timedOut :
+             alarms[i].kind == AL_TERM ?
+             alarms[i].when.tv_sec == info->deadline.tv_sec &&
+             alarms[i].when.tv_nsec == info->deadline.tv_nsec :
+             info->throttle && alarms[i].when.tv_sec == info->throttleNext.tv_sec &&
+             alarms[i].when.tv_nsec == info->throttleNext.tv_nsec)) {
+            alarms[count++] = alarms[i];
+        }
+    }
+    alarmCount = 0;
+    for (i = 0; i < count; i++) {
+        live = alarms[i];
+        addAlarm(live.when, live.pid, live.kind);
+    }
+    armTimer();
+}
+
+/* armTimer - Set the timerfd for the earliest timer, or disarm it */
+void armTimer(void)
+{
+    struct itimerspec spec;
+    
+    memset(&spec, 0, sizeof(spec));
+    if (alarmCount > 0) {
+        spec.it_value = alarms[0].when;
+    }
+    if (timerFd >= 0 && timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+        unix_error("timerfd_settime error");
+}
+
+/*
+ * runAlarms - Act on every timer that has come due: a passed deadline
+ *    sends SIGTERM to the job's process group and a SIGKILL follows
+ *    KILLGRACE seconds later if the job is still there, throttled jobs
+ *    are paused and resumed
+ */
+void runAlarms(void)
+{
+    struct timespec now;
+    struct alarm_t due;
+    struct tsh_job *job;
+    struct jobinfo_t *info;
+    uint64_t expirations;
+    
+    // clear the timerfd, it is rearmed below
+    if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        unix_error("timerfd read error");
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    while (alarmCount > 0 && (alarms[0].when.tv_sec < now.tv_sec ||
+           (alarms[0].when.tv_sec == now.tv_sec && alarms[0].when.tv_nsec <= now.tv_nsec))) {
+        due = popAlarm();
+        if (due.kind == AL_MEMCHECK) {
+            if (due.when.tv_sec == memCheckNext.tv_sec && due.when.tv_nsec == memCheckNext.tv_nsec) {
+                runMemCheck(now);
+            }
+            continue;
+        }
+        job = tsh_getjobpid(&shell, due.pid);
+        if (!job) {
+            continue;
+        }
+        info = jobinfo(job);
+        if (due.kind == AL_TERM && !info->timedOut &&
+            due.when.tv_sec == info->deadline.tv_sec && due.when.tv_nsec == info->deadline.tv_nsec) {
+            debugLog("Job [%d] (%d) passed its deadline\n", job->jid, job->pid);
+            info->timedOut = 1;
+            killpg(job->pgid, SIGTERM);
+            // a stopped job only sees the SIGTERM once it runs again
+            killpg(job->pgid, SIGCONT);
+            due.when = now;
+            due.when.tv_sec += KILLGRACE;
+            addAlarm(due.when, due.pid, AL_KILL);
+        }
+        else if (due.kind == AL_KILL && info->timedOut) {
+            debugLog("Job [%d] (%d) ignored SIGTERM, killing it\n", job->jid, job->pid);
+            killpg(job->pgid, SIGKILL);
+        }
+        else if ((due.kind == AL_PAUSE || due.kind == AL_RESUME) && info->throttle &&
+                 due.when.tv_sec == info->throttleNext.tv_sec && due.when.tv_nsec == info->throttleNext.tv_nsec) {
+            runThrottle(job, &due, now);
+        }
+    }
+    armTimer();
+}
+
+/*
+ * pollTimers - ppoll with mask until fd (-1 for none) is readable, a
+ *    timer comes due or the memguard trigger fires, and handle the
+ *    last two. Returns 1 if fd is readable, 0 if not and -1 if ppoll
+ *    failed or was interrupted.
+ */
+int pollTimers(int fd, const sigset_t *mask)
+{
+    struct pollfd fds[3] = {
+        { .fd = fd, .events = POLLIN },
+        { .fd = timerFd, .events = POLLIN },
+        { .fd = psiFd, .events = POLLPRI },
+    };
+    
+    if (ppoll(fds, 3, NULL, mask) < 0) {
+        return -1;
+    }
+    if (fds[1].revents & POLLIN) {
+        runAlarms();
+    }
+    if (fds[2].revents & POLLERR) {
+        // the trigger's file went away
+        outPrintf("memguard: pressure trigger failed, turned off\n");
+        close(psiFd);
+        psiFd = -1;
+    }
+    else if (fds[2].revents & POLLPRI) {
+        runMemGuard();
+    }
+    return (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+}
+
+/*
+ * readLine - Read one line of stdin into cmdline like fgets, running
+ *    due deadlines and draining signal events while we wait for it.
+ *    Returns 0 at end of file.
+ */
+int readLine(char *cmdline, int size)
+{
+    sigset_t blockListSet, prevSet;
+    int ready;
+    char *newline;
+    size_t len;
+    ssize_t count;
+    
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigaddset(&blockListSet, SIGINT);
+    sigaddset(&blockListSet, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+    
+    while (1) {
+        newline = memchr(inBuf, '\n', inLen);
+        if (newline || inLen >= (size_t)size - 1) {
+            len = newline ? (size_t)(newline - inBuf) + 1 : inLen;
+            memcpy(cmdline, inBuf, len);
+            cmdline[len] = '\0';
+            memmove(inBuf, inBuf + len, inLen - len);
+            inLen -= len;
+            break;
+        }
+        if (inEOF) {
+            // like fgets then feof, an unfinished last line is dropped
+            sigprocmask(SIG_SETMASK, &prevSet, NULL);
+            return 0;
+        }
+        
+        if ((ready = pollTimers(STDIN_FILENO, &prevSet)) < 0) {
+            if (errno != EINTR)
+                unix_error("ppoll error");
+            // a signal: show set -b notifications while we sit at the prompt
+            drainEvents();
+            flushOutput();
+            continue;
+        }
+        if (ready) {
+            count = read(STDIN_FILENO, inBuf + inLen, size - 1 - inLen);
+            if (count < 0 && errno != EINTR && errno != EAGAIN)
+                unix_error("read error");
+            if (count == 0)
+                inEOF = 1;
+            if (count > 0)
+                inLen += count;
+        }
+    }
+    
+    sigprocmask(SIG_SETMASK, &prevSet, NULL);
+    return 1;
+}
+
+/*****************
+ * Job throttling
+ *****************/
+
+/*
+ * do_throttle - Execute the builtin throttle command:
+ *    throttle SELECTOR ... PERCENT|off
+ *
+ * Holds the selected jobs to PERCENT of one CPU without cgroups: every
+ * THROTTLEMS period the job's process group runs for PERCENT of it and
+ * is stopped with SIGSTOP for the rest, driven by the deadline timer
+ * heap. 100 or off lets the jobs run freely again. jobs shows the
+ * target share and the share the job actually got since it was
+ * throttled.
+ */
+void do_throttle(char **argv, int argc)
+{
+    struct tsh_job* selected[MAXJOBS];
+    sigset_t blockListSet, prevSet;
+    struct timespec now;
+    char *end;
+    long percent;
+    int count, i;
+    
+    if (argc < 3) {
+        outPrintf("throttle: usage: throttle PID|%%jobid ... PERCENT|off\n");
+        return;
+    }
+    if (!strcmp(argv[argc - 1], "off")) {
+        percent = 100;
+    }
+    else if ((percent = strtol(argv[argc - 1], &end, 10)) < 1 || percent > 100 ||
+             end == argv[argc - 1] || *end) {
+        outPrintf("throttle: %s: percent must be 1 to 100 or off\n", argv[argc - 1]);
+        return;
+    }
+    
+    // drain first so no stop report from an earlier throttle is still queued
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+    drainEvents();
+    if ((count = selectJobs(argv + 1, argc - 2, "throttle", selected)) < 0) {
+        sigprocmask(SIG_SETMASK, &prevSet, NULL);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (i = 0; i < count; i++) {
+        if (percent == 100) {
+            unthrottleJob(selected[i]);
+            continue;
+        }
+        struct jobinfo_t *info = jobinfo(selected[i]);
+        if (!info->throttle) {
+            // start the books and let it run for its first share
+            info->throttleSince = now;
+            groupUsage(selected[i], &info->throttleCpu, NULL);
+            info->throttle = percent;
+            throttleAlarm(selected[i], now, AL_PAUSE, percent * THROTTLEMS / 100);
+        }
+        // an already throttled job picks the new share up at its next pause or resume
+        info->throttle = percent;
+        debugLog("Job [%d] throttled to %ld%%\n", selected[i]->jid, percent);
+    }
+    sigprocmask(SIG_SETMASK, &prevSet, NULL);
+}
+
+/* throttleAlarm - Schedule the job's next pause or resume msec after from */
+void throttleAlarm(struct tsh_job *job, struct timespec from, int kind, long msec)
+{
+    from.tv_nsec += msec * 1000000;
+    from.tv_sec += from.tv_nsec / 1000000000;
+    from.tv_nsec %= 1000000000;
+    jobinfo(job)->throttleNext = from;
+    addAlarm(from, job->pid, kind);
+}
+
+/*
+ * unthrottleJob - Let a throttled job run freely again. Callers block
+ *    SIGCHLD and drain the event queue first: once the SIGCONT is sent
+ *    the kernel drops a stop we have not waited for yet, so no report
+ *    of the throttle's last SIGSTOP can show up as a real stop later.
+ */
+void unthrottleJob(struct tsh_job *job)
+{
+    struct jobinfo_t *info = jobinfo(job);
+    
+    info->throttle = 0;
+    info->throttleNext.tv_sec = 0;
+    info->throttleNext.tv_nsec = 0;
+    if (info->throttlePaused) {
+        info->throttlePaused = 0;
+        if (job->state != ST) {
+            killpg(job->pgid, SIGCONT);
+        }
+    }
+    debugLog("Job [%d] no longer throttled\n", job->jid);
+}
+
+/*
+ * runThrottle - Pause or resume a throttled job when its alarm is due.
+ *    A job the user stopped is left alone but keeps its cycle going,
+ *    so bg picks the throttle up again.
+ */
+void runThrottle(struct tsh_job *job, struct alarm_t *due, struct timespec now)
+{
+    struct jobinfo_t *info = jobinfo(job);
+    long runMsec = info->throttle * THROTTLEMS / 100;
+    struct timespec from = due->when;
+    
+    if (now.tv_sec - from.tv_sec > 1) {
+        // we were busy for a while, don't try to catch up
+        from = now;
+    }
+    if (job->state == ST) {
+        info->throttlePaused = 0;
+        throttleAlarm(job, from, AL_PAUSE, THROTTLEMS);
+    }
+    else if (due->kind == AL_PAUSE) {
+        info->throttlePaused = 1;
+        killpg(job->pgid, SIGSTOP);
+        throttleAlarm(job, from, AL_RESUME, THROTTLEMS - runMsec);
+    }
+    else {
+        info->throttlePaused = 0;
+        killpg(job->pgid, SIGCONT);
+        throttleAlarm(job, from, AL_PAUSE, runMsec);
+    }
+}
+
+/*
+ * groupUsage - CPU time and resident memory of the job right now: every
+ *    live process of its process group from /proc, the CPU time
+ *    including the children they reaped, plus the CPU time of the
+ *    descendants we reaped ourselves. Either pointer may be NULL.
+ */
+void groupUsage(struct tsh_job *job, long *cpuUsec, long *rssKB)
+{
+    static long ticksPerSec = 0, pageKB = 0;
+    unsigned long long ticks = 0, pages = 0;
+    struct dirent *entry;
+    char path[300], stat[512];
+    DIR *proc;
+    
+    if (!ticksPerSec) {
+        ticksPerSec = sysconf(_SC_CLK_TCK);
+        pageKB = sysconf(_SC_PAGESIZE) / 1024;
+    }
+    if ((proc = opendir("/proc")) != NULL) {
+        while ((entry = readdir(proc)) != NULL) {
+            unsigned long utime, stime;
+            long cutime, cstime, rss;
+            int pgrp, fd;
+            ssize_t len;
+            char *fields;
+            
+            if (!isdigit((unsigned char) entry->d_name[0])) {
+                continue;
+            }
+            snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name);
+            if ((fd = open(path, O_RDONLY)) < 0) {
+                continue;
+            }
+            len = read(fd, stat, sizeof(stat) - 1);
+            close(fd);
+            // the command name can hold spaces and parens, the fields start after the last )
+            if (len <= 0 || (stat[len] = '\0', !(fields = strrchr(stat, ')')))) {
+                continue;
+            }
+            if (sscanf(fields + 2, "%*c %*d %d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld "
+                       "%*d %*d %*d %*d %*u %*u %ld",
+                       &pgrp, &utime, &stime, &cutime, &cstime, &rss) == 6 && pgrp == job->pgid) {
+                ticks += utime + stime + cutime + cstime;
+                pages += rss;
+            }
+        }
+        closedir(proc);
+    }
+    if (cpuUsec) {
+        *cpuUsec = (long)(ticks * 1000000 / ticksPerSec) + job->cpuUsec;
+    }
+    if (rssKB) {
+        *rssKB = (long)(pages * pageKB);
+    }
+}
+
+/*****************
+ * Memory pressure guard
+ *****************/
+
+/*
+ * do_memguard - Execute the builtin memguard command:
+ *    memguard STALL [WINDOW]   guard against memory pressure
+ *    memguard off              stop guarding, the jobs it stopped stay stopped
+ *    memguard                  show the setting
+ *
+ * Registers a PSI trigger on /proc/pressure/memory that fires when
+ * tasks stalled on memory for STALL within a WINDOW (default 2s, the
+ * kernel only lets unprivileged users use multiples of 2s).
+ * Each time it fires the background job with the largest RSS is
+ * stopped. Once the 10 second pressure average is below half the
+ * trigger's share and MEMQUIET seconds passed without a stop or
+ * resume, the jobs are resumed one at a time, last stopped first.
+ * Every stop and resume is announced like a job notification and
+ * jobs marks the jobs memguard holds.
+ */
+void do_memguard(char **argv, int argc)
+{
+    struct timespec stall, window = {2, 0};
+    long stallUsec, windowUsec;
+    char trigger[64];
+    int fd, i;
+    
+    if (argc == 1) {
+        if (psiFd < 0) {
+            outPrintf("memguard: off\n");
+        }
+        else {
+            outPrintf("memguard: stop jobs on %ld ms memory stall per %ld ms, now avg10=%.2f\n",
+                      psiStallUsec / 1000, psiWindowUsec / 1000, memPressure());
+        }
+        return;
+    }
+    if (argc == 2 && !strcmp("off", argv[1])) {
+        if (psiFd >= 0) {
+            close(psiFd);
+            psiFd = -1;
+        }
+        // jobs memguard still holds stay stopped for bg or fg, it lets go of them
+        for (i = 0; i < MAXJOBS; i++)
+            jobInfo[i].memStopped = 0;
+        memCheckNext.tv_sec = 0;
+        memCheckNext.tv_nsec = 0;
+        return;
+    }
+    if (argc > 3 || parseDuration(argv[1], &stall) < 0 ||
+        (argc == 3 && parseDuration(argv[2], &window) < 0)) {
+        outPrintf("memguard: usage: memguard STALL [WINDOW] | off\n");
+        return;
+    }
+    
+    // a new trigger replaces the old one
+    if ((fd = open("/proc/pressure/memory", O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0) {
+        outPrintf("memguard: /proc/pressure/memory: %s\n", strerror(errno));
+        return;
+    }
+    stallUsec = stall.tv_sec * 1000000 + stall.tv_nsec / 1000;
+    windowUsec = window.tv_sec * 1000000 + window.tv_nsec / 1000;
+    snprintf(trigger, sizeof(trigger), "some %ld %ld", stallUsec, windowUsec);
+    if (write(fd, trigger, strlen(trigger) + 1) < 0) {
+        // the old trigger and its thresholds stay
+        outPrintf("memguard: %s: %s\n", trigger, strerror(errno));
+        close(fd);
+        return;
+    }
+    if (psiFd >= 0) {
+        close(psiFd);
+    }
+    psiFd = fd;
+    psiStallUsec = stallUsec;
+    psiWindowUsec = windowUsec;
+    debugLog("memguard trigger \"%s\"\n", trigger);
+}
+
+/*
+ * runMemGuard - The pressure trigger fired: stop the running background
+ *    job with the largest RSS and start checking for the pressure to go
+ *    back down
+ */
+void runMemGuard(void)
+{
+    struct tsh_job *largest = NULL;
+    long rssKB, largestKB = -1;
+    int i;
+    
+    drainEvents();
+    clock_gettime(CLOCK_MONOTONIC, &memLastAction);
+    for (i = 0; i < MAXJOBS; i++) {
+        if (jobs[i].pid != 0 && jobs[i].state == BG) {
+            groupUsage(&jobs[i], NULL, &rssKB);
+            if (rssKB > largestKB) {
+                largestKB = rssKB;
+                largest = &jobs[i];
+            }
+        }
+    }
+    if (!largest) {
+        debugLog("Memory pressure but no running background job\n");
+        return;
+    }
+    
+    if (jobinfo(largest)->throttle) {
+        unthrottleJob(largest);
+    }
+    jobinfo(largest)->memStopped = 1;
+    jobinfo(largest)->memStoppedAt = memLastAction;
+    killpg(largest->pgid, SIGSTOP);
+    tsh_setstate(&shell, largest, ST);
+    notify("Job [%d] (%d) stopped by memguard, rss %ld KB, memory pressure avg10=%.2f\n",
+           largest->jid, largest->pid, largestKB, memPressure());
+    
+    if (!memCheckNext.tv_sec && !memCheckNext.tv_nsec) {
+        memCheckNext = memLastAction;
+        memCheckNext.tv_sec += MEMCHECKMS / 1000;
+        addAlarm(memCheckNext, 0, AL_MEMCHECK);
+    }
+}
+
+/*
+ * runMemCheck - Resume the job memguard stopped last if the pressure has
+ *    been low for a while, and keep checking while it holds any
+ */
+void runMemCheck(struct timespec now)
+{
+    struct tsh_job *latest = NULL;
+    struct timespec latestAt = {0, 0};
+    double pressure;
+    int i;
+    
+    memCheckNext.tv_sec = 0;
+    memCheckNext.tv_nsec = 0;
+    for (i = 0; i < MAXJOBS; i++) {
+        struct timespec at = jobInfo[i].memStoppedAt;
+        if (jobs[i].pid != 0 && jobInfo[i].memStopped &&
+            (!latest || at.tv_sec > latestAt.tv_sec ||
+             (at.tv_sec == latestAt.tv_sec && at.tv_nsec > latestAt.tv_nsec))) {
+            latest = &jobs[i];
+            latestAt = at;
+        }
+    }
+    if (!latest) {
+        return;
+    }
+    
+    // hysteresis: below half the trigger's stall share and quiet for a while
+    pressure = memPressure();
+    if (now.tv_sec - memLastAction.tv_sec >= MEMQUIET &&
+        pressure < 50.0 * psiStallUsec / psiWindowUsec) {
+        jobinfo(latest)->memStopped = 0;
+        tsh_bg(&shell, latest);
+        notify("Job [%d] (%d) resumed by memguard, memory pressure avg10=%.2f\n",
+               latest->jid, latest->pid, pressure);
+        memLastAction = now;
+    }
+    memCheckNext = now;
+    memCheckNext.tv_sec += MEMCHECKMS / 1000;
+    addAlarm(memCheckNext, 0, AL_MEMCHECK);
+}
+
+/* memPressure - The "some" avg10 of /proc/pressure/memory, 0 if unknown */
+double memPressure(void)
+{
+    char text[256];
+    double avg10 = 0;
+    ssize_t len;
+    int fd;
+    
+    if ((fd = open("/proc/pressure/memory", O_RDONLY | O_CLOEXEC)) < 0) {
+        return 0;
+    }
+    len = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (len > 0) {
+        text[len] = '\0';
+        sscanf(text, "some avg10=%lf", &avg10);
+    }
+    return avg10;
+}
+
+/*****************
+ * Job DAGs
+ *****************/
+
+/*
+ * do_dag - Execute the builtin dag command: dag [-j N] FILE
+ *
+ * FILE declares one job per line as
+ *     NAME [COST] : [DEPENDENCY ...] : COMMAND
+ * where COST is a rough run time above 0 (default 1) used to rank the jobs and
+ * COMMAND is an and-or list. Lines starting with # are comments. Every
+ * job whose dependencies have all succeeded is started in the
+ * background, at most N (default: online CPUs) at a time, highest rank
+ * first. A failed job cancels everything that depends on it. dag
+ * returns when nothing is left to run and reports the makespan;
+ * ctrl-c interrupts the jobs still running and cancels the rest.
+ */
+void do_dag(char **argv, int argc)
+{
+    char path[MAXLINE];
+    long limit = sysconf(_SC_NPROCESSORS_ONLN);
+    int i, freeSlots, running = 0, done = 0, failed = 0, cancelled = 0, interrupted = 0;
+    struct timespec start, now;
+    sigset_t blockListSet, prevSet;
+    
+    if (argc == 4 && !strcmp("-j", argv[1])) {
+        limit = atol(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 2 || limit < 1) {
+        outPrintf("dag: usage: dag [-j N] FILE\n");
+        lastStatus = 2;
+        return;
+    }
+    if (inSubshell) {
+        outPrintf("dag: can't run in a background list\n");
+        lastStatus = 1;
+        return;
+    }
+    // starting jobs recycles the words argv points into
+    strcpy(path, argv[1]);
+    if (loadDag(path) < 0) {
+        lastStatus = 1;
+        return;
+    }
+    
+    freeSlots = 0;
+    for (i = 0; i < MAXJOBS; i++)
+        if (jobs[i].pid == 0)
+            freeSlots++;
+    if (limit > freeSlots)
+        limit = freeSlots;
+    if (limit < 1) {
+        outPrintf("dag: no free job slots\n");
+        lastStatus = 1;
+        return;
+    }
+    
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sigemptyset(&blockListSet);
+    sigaddset(&blockListSet, SIGCHLD);
+    sigaddset(&blockListSet, SIGINT);
+    sigaddset(&blockListSet, SIGTSTP);
+    lineInterrupted = 0;
+    dagRunning = 1;
+    
+    while (1) {
+        // settle the jobs that finished since we last looked
+        for (i = 0; i < dagCount; i++) {
+            struct dagnode_t *node = &dagNodes[i];
+            if (node->state != DAG_EXITED)
+                continue;
+            running--;
+            if (WIFEXITED(node->status) && WEXITSTATUS(node->status) == 0) {
+                node->state = DAG_DONE;
+                done++;
+                int j;
+                for (j = 0; j < dagCount; j++)
+                    if (dagNodes[j].state == DAG_PENDING && dagDependsOn(&dagNodes[j], i))
+                        dagNodes[j].waiting--;
+            }
+            else {
+                node->state = DAG_FAILED;
+                failed++;
+                outPrintf("dag: %s failed (%s %d)\n", node->name,
+                       WIFEXITED(node->status) ? "status" : "signal",
+                       WIFEXITED(node->status) ? WEXITSTATUS(node->status) : WTERMSIG(node->status));
+                cancelled += cancelDagDependents(i);
+            }
+        }
+        
+        if (lineInterrupted && !interrupted) {
+            // ctrl-c: stop what is running and don't start anything new
+            interrupted = 1;
+            for (i = 0; i < dagCount; i++) {
+                if (dagNodes[i].state == DAG_PENDING) {
+                    dagNodes[i].state = DAG_CANCELLED;
+                    cancelled++;
+                }
+                else if (dagNodes[i].state == DAG_RUNNING) {
+                    struct tsh_job *job = tsh_getjobpid(&shell, dagNodes[i].pid);
+                    if (job)
+                        killpg(job->pgid, SIGINT);
+                }
+            }
+        }
+        
+        while (running < limit) {
+            int best = -1;
+            for (i = 0; i < dagCount; i++)
+                if (dagNodes[i].state == DAG_PENDING && dagNodes[i].waiting == 0 &&
+                    (best < 0 || dagNodes[i].rank > dagNodes[best].rank))
+                    best = i;
+            if (best < 0)
+                break;
+            if (startDagNode(&dagNodes[best]) < 0) {
+                outPrintf("dag: %s could not be started\n", dagNodes[best].name);
+                dagNodes[best].state = DAG_FAILED;
+                failed++;
+                cancelled += cancelDagDependents(best);
+                continue;
+            }
+            running++;
+        }
+        if (running == 0)
+            break;
+        
+        // wait like waitfg until one of ours is reaped
+        sigprocmask(SIG_BLOCK, &blockListSet, &prevSet);
+        drainEvents();
+        flushOutput();
+        if (!dagChanged && (interrupted || !lineInterrupted)) {
+            pollTimers(-1, &prevSet);
+        }
+        drainEvents();
+        dagChanged = 0;
+        sigprocmask(SIG_SETMASK, &prevSet, NULL);
+    }
+    dagRunning = 0;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long makespan = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+    outPrintf("dag: %d jobs, %d done, %d failed, %d cancelled, makespan %ld.%03lds\n",
+           dagCount, done, failed, cancelled, makespan / 1000, makespan % 1000);
+    lastStatus = (failed || cancelled) ? 1 : 0;
+}
+
+/*
+ * loadDag - Read a DAG file into dagNodes and rank the jobs by their
+ *    longest remaining path. Returns 0, or -1 after printing a message.
+ */
+int loadDag(const char *path)
+{
+    char line[MAXLINE];
+    char *depNames[MAXDAGNODES];
+    FILE *file;
+    int lineNo = 0, i, j, done;
+    
+    if ((file = fopen(path, "r")) == NULL) {
+        outPrintf("dag: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    dagCount = 0;
+    
+    // first pass: names, costs and commands
+    while (fgets(line, MAXLINE, file)) {
+        char *first, *second, *word;
+        struct dagnode_t *node;
+        lineNo++;
+        
+        line[strcspn(line, "\n")] = '\0';
+        word = line + strspn(line, " \t");
+        if (*word == '\0' || *word == '#')
+            continue;
+        if ((first = strchr(line, ':')) == NULL || (second = strchr(first + 1, ':')) == NULL) {
+            outPrintf("dag: %s:%d: expected NAME [COST] : DEPENDENCIES : COMMAND\n", path, lineNo);
+            fclose(file);
+            freeDagNames(depNames);
+            return -1;
+        }
+        if (dagCount == MAXDAGNODES) {
+            outPrintf("dag: %s: more than %d jobs\n", path, MAXDAGNODES);
+            fclose(file);
+            freeDagNames(depNames);
+            return -1;
+        }
+        *first = *second = '\0';
+        node = &dagNodes[dagCount];
+        memset(node, 0, sizeof(*node));
+        node->cost = 1;
+        
+        word = strtok(line, " \t");
+        if (!word || strlen(word) >= MAXDAGNAME || findDagNode(word) >= 0) {
+            outPrintf("dag: %s:%d: missing, long or duplicate job name\n", path, lineNo);
+            fclose(file);
+            freeDagNames(depNames);
+            return -1;
+        }
+        strcpy(node->name, word);
+        if ((word = strtok(NULL, " \t")) != NULL) {
+            char *end;
+            node->cost = strtod(word, &end);
+            if (*end != '\0' || !(node->cost > 0) || isinf(node->cost) ||
+                strtok(NULL, " \t") != NULL) {
+                outPrintf("dag: %s:%d: job cost must be a number above 0\n", path, lineNo);
+                fclose(file);
+                freeDagNames(depNames);
+                return -1;
+            }
+        }
+        // dependencies may name jobs further down, resolve them afterwards
+        depNames[dagCount] = strdup(first + 1);
+        snprintf(node->command, MAXLINE, "%s &\n", second + 1 + strspn(second + 1, " \t"));
+        dagCount++;
+    }
+    fclose(file);
+    
+    // second pass: resolve dependency names and check the commands
+    for (i = 0; i < dagCount; i++) {
+        struct dagnode_t *node = &dagNodes[i];
+        struct cmdline_t *cmdLine;
+        struct cmd_t *cmd;
+        char *word;
+        int ok = 1;
+        
+        for (word = strtok(depNames[i], " \t"); word && ok; word = strtok(NULL, " \t")) {
+            if ((j = findDagNode(word)) < 0) {
+                outPrintf("dag: %s: %s depends on unknown job %s\n", path, node->name, word);
+                ok = 0;
+            }
+            else if (!dagDependsOn(node, j)) {
+                node->dep[node->depCount++] = j;
+            }
+        }
+        node->waiting = node->depCount;
+        
+        if (ok && (cmdLine = parseCommandLine(node->command)) != NULL) {
+            ok = cmdLine->cmds != NULL;
+            for (cmd = cmdLine->cmds; cmd && ok; cmd = cmd->next)
+                ok = cmd->next ? (cmd->connector == CON_AND || cmd->connector == CON_OR) :
+                                 (cmd->connector == CON_BG);
+            freeCommandLine(cmdLine);
+            if (!ok)
+                outPrintf("dag: %s: %s's command must be one and-or list\n", path, node->name);
+        }
+        else if (ok) {
+            // parseCommandLine already said what is wrong
+            ok = 0;
+        }
+        if (!ok) {
+            for (; i < dagCount; i++)
+                free(depNames[i]);
+            return -1;
+        }
+        free(depNames[i]);
+    }
+    
+    // rank = cost of the longest path from the job to the end, computed
+    // sinks first; a pass that makes no progress means there is a cycle
+    for (i = 0; i < dagCount; i++)
+        dagNodes[i].rank = -1;
+    done = 0;
+    while (done < dagCount) {
+        int progress = 0;
+        for (i = 0; i < dagCount; i++) {
+            double longest = 0;
+            int ready = 1;
+            if (dagNodes[i].rank >= 0)
+                continue;
+            for (j = 0; j < dagCount && ready; j++) {
+                if (dagDependsOn(&dagNodes[j], i)) {
+                    if (dagNodes[j].rank < 0)
+                        ready = 0;
+                    else if (dagNodes[j].rank > longest)
+                        longest = dagNodes[j].rank;
+                }
+            }
+            if (ready) {
+                dagNodes[i].rank = dagNodes[i].cost + longest;
+                done++;
+                progress = 1;
+            }
+        }
+        if (!progress) {
+            for (i = 0; dagNodes[i].rank >= 0; i++)
+                ;
+            outPrintf("dag: %s: dependency cycle through %s\n", path, dagNodes[i].name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* freeDagNames - Free the dependency lists loadDag read so far */
+void freeDagNames(char **depNames)
+{
+    int i;
+    
+    for (i = 0; i < dagCount; i++)
+        free(depNames[i]);
+}
+
+/* findDagNode - Index of the job called name, or -1 */
+int findDagNode(const char *name)
+{
+    int i;
+    
+    for (i = 0; i < dagCount; i++)
+        if (!strcmp(dagNodes[i].name, name))
+            return i;
+    return -1;
+}
+
+/* dagDependsOn - Does node wait for job index? */
+int dagDependsOn(struct dagnode_t *node, int index)
+{
+    int i;
+    
+    for (i = 0; i < node->depCount; i++)
+        if (node->dep[i] == index)
+            return 1;
+    return 0;
+}
+
+/*
+ * cancelDagDependents - Cancel every pending job that depends on job
+ *    index, directly or not. Returns how many were cancelled.
+ */
+int cancelDagDependents(int index)
+{
+    int i, count = 0;
+    
+    for (i = 0; i < dagCount; i++) {
+        if (dagNodes[i].state == DAG_PENDING && dagDependsOn(&dagNodes[i], index)) {
+            dagNodes[i].state = DAG_CANCELLED;
+            outPrintf("dag: %s cancelled, %s failed\n", dagNodes[i].name, dagNodes[index].name);
+            count += 1 + cancelDagDependents(i);
+        }
+    }
+    return count;
+}
+
+/*
+ * startDagNode - Start a job's command in the background.
+ *    Returns 0, or -1 if it could not be started.
+ */
+int startDagNode(struct dagnode_t *node)
+{
+    struct cmdline_t *cmdLine = parseCommandLine(node->command);
+    struct cmd_t *last;
+    char text[MAXLINE];
+    
+    if (!cmdLine) {
+        return -1;
+    }
+    for (last = cmdLine->cmds; last->next; last = last->next)
+        ;
+    commandText(cmdLine->cmds, last, text);
+    if (cmdLine->cmds == last) {
+        node->pid = runCommand(last, 1, text);
+    }
+    else {
+        node->pid = runBackgroundList(cmdLine->cmds, last);
+    }
+    freeCommandLine(cmdLine);
+    clearLineCache();
+    if (node->pid <= 0) {
+        return -1;
+    }
+    node->state = DAG_RUNNING;
+    return 0;
+}
+
+/*
+ * dagJobDone - Called when a job's leader is reaped: record its status
+ *    if it belongs to the running DAG
+ */
+void dagJobDone(pid_t pid, int status)
+{
+    int i;
+    
+    if (!dagRunning)
+        return;
+    for (i = 0; i < dagCount; i++) {
+        if (dagNodes[i].state == DAG_RUNNING && dagNodes[i].pid == pid) {
+            dagNodes[i].state = DAG_EXITED;
+            dagNodes[i].status = status;
+            dagChanged = 1;
+            return;
+        }
+    }
+}
+
+/*****************
+ * Signal handlers
+ *****************/
+
+/*
+ * sigchld_handler - The kernel sends a SIGCHLD to the shell whenever
+ *     a child job terminates (becomes a zombie), or stops because it
+ *     received a SIGSTOP or SIGTSTP signal. The handler reaps all
+ *     available zombie children, but doesn't wait for any other
+ *     currently running children to terminate. Each reap becomes an
+ *     EV_CHILD event; a slot is claimed before waitpid so a full queue
+ *     leaves the child for the next drain instead of losing its status.
+ *     As a subreaper we also get the jobs' orphaned descendants, so the
+ *     event records the child's process group and resource usage too.
+ */
+void sigchld_handler(int sig)
+{
+    int savedErrno = errno;
+    struct event_t* event;
+    unsigned int pos;
+    
+    record(REC_SIGNAL, 0, sig);
+    while ((event = reserveEvent(&pos)) != NULL) {
+        siginfo_t info;
+        struct rusage usage;
+        
+        // peek first: a zombie still has its process group, which says whose job it was
+        event->pid = 0;
+        info.si_pid = 0;
+        if (waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOHANG | WNOWAIT) == 0 && info.si_pid > 0) {
+            event->pgid = getpgid(info.si_pid);
+            event->pid = wait4(info.si_pid, &event->status, WNOHANG | WUNTRACED, &usage);
+        }
+        if (event->pid > 0) {
+            record(REC_REAP, event->pid, event->status);
+            event->kind = EV_CHILD;
+            event->cpuUsec = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L +
+                             usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+            event->maxrssKB = usage.ru_maxrss;
+        }
+        publishEvent(event, pos);
+        if (event->pid <= 0) {
+            break;
+        }
+    }
+    if (!event) {
+        eventsOverflowed = 1;
+    }
+    errno = savedErrno;
+}
+
+/*
+ * sigint_handler - The kernel sends a SIGINT to the shell whenver the
+ *    user types ctrl-c at the keyboard.  Queue it, the main loop sends
+ *    it along to the foreground job.
+ */
+void sigint_handler(int sig)
+{
+    record(REC_SIGNAL, 0, sig);
+    pushEvent(EV_INT);
+}
+
+
+/*
+ * sigtstp_handler - The kernel sends a SIGTSTP to the shell whenever
+ *     the user types ctrl-z at the keyboard. Queue it, the main loop
+ *     suspends the foreground job by sending it a SIGTSTP.
+ */
+void sigtstp_handler(int sig)
+{
+    record(REC_SIGNAL, 0, sig);
+    pushEvent(EV_TSTP);
+}
+
+/*********************
+ * End signal handlers
+ *********************/
+/*****************
+ * Job table
+ *****************/
+
+/*
+ * initShellJobs - Start an empty libtsh job table that launches through
+ *    the fork server and keeps jobInfo and the recorder in step
+ */
+void initShellJobs(void)
+{
+    tsh_init(&shell);
+    shell.hooks.launch = launchJob;
+    shell.hooks.beforeExec = beforeJobExec;
+    shell.hooks.execFailed = jobExecFailed;
+    tsh_subscribe(&shell, jobChanged, NULL);
+}
+
+/* jobChanged - libtsh subscriber: record state changes, reset new jobs' info */
+void jobChanged(struct tsh_ctx *ctx, struct tsh_job *job, int oldState, void *arg)
+{
+    record(REC_STATE, job->pid, job->state);
+    if (job->state == UNDEF) {
+        debugLog("Job [%d] used %ld us cpu, %ld KB max rss in %d processes\n", job->jid,
+                 job->cpuUsec, job->memKB, job->descendants + 1);
+    }
+    if (oldState == UNDEF) {
+        memset(jobinfo(job), 0, sizeof(struct jobinfo_t));
+        if (verbose) {
+            outPrintf("Added job [%d] %d %s\n", job->jid, job->pid, job->cmdline);
+        }
+    }
+}
+
+/* launchJob - libtsh launch hook: use the fork server if there is one */
+pid_t launchJob(void *arg, char *path, char **argv, char **envp, int *pidfd)
+{
+    pid_t pid;
+    
+    if (forkServerFd < 0) {
+        return -1;
+    }
+    pid = forkServerSpawn(path, argv, envp, pidfd);
+    launchedByServer = (pid > 0);
+    // libtsh forks when the server failed, write what it said first
+    flushOutput();
+    return pid;
+}
+
+/* beforeJobExec - libtsh hook, in a forked job right before execve */
+void beforeJobExec(void *arg)
+{
+    // the shell's buffered output is still the shell's to write, a launch
+    // hook that fell back to fork may have added to it since the last flush
+    outLen = 0;
+    debugLog("Child has pgid %d\n", getpgrp());
+    flushOutput();
+    recordSelf = getpid();
+    record(REC_EXEC, recordSelf, 0);
+}
+
+/* jobExecFailed - libtsh hook, in a forked job whose execve failed */
+void jobExecFailed(void *arg, const char *path)
+{
+    // _exit so stdin's buffer is left alone
+    outPrintf("%s: Command Not Found\n", path);
+    flushOutput();
+    _exit(1);
+}
+
+#pragma mark Given Helper Functions
+/***********************************************
+ * Helper routines that manipulate the job list
+ **********************************************/
+
+/* jobinfo - The shell's own state of a job of the shell's job table */
+struct jobinfo_t *jobinfo(struct tsh_job *job)
+{
+    return &jobInfo[job - shell.jobs];
+}
+
+/* listjobs - Print the job list */
+void listjobs(struct tsh_job *jobs)
+{
+    int i;
+    
+    for (i = 0; i < MAXJOBS; i++) {
+        if (jobs[i].pid != 0) {
+            listjob(&jobs[i]);
+        }
+    }
+}
+
+/* listjob - Print one job */
+void listjob(struct tsh_job *job)
+{
+    struct jobinfo_t *info = jobinfo(job);
+    
+    outPrintf("[%d] (%d) ", job->jid, job->pid);
+    switch (job->state) {
+        case BG:
+            outPrintf("Running ");
+            break;
+        case FG:
+            outPrintf("Foreground ");
+            break;
+        case ST:
+            outPrintf("Stopped ");
+            break;
+        default:
+            outPrintf("listjobs: Internal error: job[%d].state=%d ",
+                   job->jid, job->state);
+    }
+    if (info->timedOut) {
+        outPrintf("(timed out) ");
+    }
+    else if (info->deadline.tv_sec || info->deadline.tv_nsec) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long leftMsec = (info->deadline.tv_sec - now.tv_sec) * 1000 +
+                        (info->deadline.tv_nsec - now.tv_nsec) / 1000000;
+        if (leftMsec < 0)
+            leftMsec = 0;
+        outPrintf("(%ld.%lds left) ", leftMsec / 1000, (leftMsec % 1000) / 100);
+    }
+    if (info->memStopped) {
+        outPrintf("(stopped for memory pressure) ");
+    }
+    if (info->throttle) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long wallUsec = (now.tv_sec - info->throttleSince.tv_sec) * 1000000 +
+                        (now.tv_nsec - info->throttleSince.tv_nsec) / 1000;
+        long cpuUsec;
+        groupUsage(job, &cpuUsec, NULL);
+        cpuUsec -= info->throttleCpu;
+        long permille = (wallUsec > 0 && cpuUsec > 0) ? cpuUsec * 1000 / wallUsec : 0;
+        outPrintf("(throttled %d%%, actual %ld.%ld%%) ", info->throttle, permille / 10, permille % 10);
+    }
+    outPrintf("%s", job->cmdline);
+}
+
+/* listjobsLong - Print the job list with each job's process tree totals */
+void listjobsLong(struct tsh_job *jobs)
+{
+    int i;
+    
+    for (i = 0; i < MAXJOBS; i++) {
+        if (jobs[i].pid != 0) {
+            listjob(&jobs[i]);
+            outPrintf("    pgid %d: %d descendants reaped, cpu %ld.%03lds, max rss %ld KB\n",
+                   jobs[i].pgid, jobs[i].descendants, jobs[i].cpuUsec / 1000000,
+                   (jobs[i].cpuUsec / 1000) % 1000, jobs[i].memKB);
+        }
+    }
+}
+
+void terminateAllUnexitedJobs(struct tsh_job* jobs){
+    int i;
+    
+    for (i = 0; i < MAXJOBS; i++) {
+        if (jobs[i].pid != 0) {
+            debugLog("%s with PID: %d was left and killed.",jobs[i].cmdline, jobs[i].pid);
+            killpg(jobs[i].pgid, SIGKILL);
+        }
+    }
+}
+        /******************************
+ * end job list helper routines
+ ******************************/
+
+
+/***********************
+ * Other helper routines
+ ***********************/
+
+/*
+ * usage - print a help message
+ */
+void usage(void)
+{
+    printf("Usage: shell [-hvpz] [-t file]\n");
+    printf("   -h   print this message\n");
+    printf("   -v   print additional diagnostic information\n");
+    printf("   -p   do not emit a command prompt\n");
+    printf("   -z   launch jobs through a pre-forked fork server\n");
+    printf("   -t   dump the event recorder to this file at exit\n");
+    exit(1);
+}
+
+/*
+ * unix_error - unix-style error routine
+ */
+void unix_error(char *msg)
+{
+    outPrintf("%s: %s\n", msg, strerror(errno));
+    flushOutput();
+    exit(1);
+}
+
+/*
+ * app_error - application-style error routine
+ */
+void app_error(char *msg)
+{
+    outPrintf("%s\n", msg);
+    flushOutput();
+    exit(1);
+}
+
+/*
+ * Signal - wrapper for the sigaction function
+ */
+handler_t *Signal(int signum, handler_t *handler)
+{
+    struct sigaction action, old_action;
+    
+    action.sa_handler = handler;
+    sigemptyset(&action.sa_mask); /* block sigs of type being handled */
+    action.sa_flags = SA_RESTART; /* restart syscalls if possible */
+    
+    if (sigaction(signum, &action, &old_action) < 0)
+        unix_error("Signal error");
+    return (old_action.sa_handler);
+}
+
+/*
+ * sigquit_handler - The driver program can gracefully terminate the
+ *    child shell by sending it a SIGQUIT signal.
+ */
+void sigquit_handler(int sig)
+{
+    outPrintf("Terminating after receipt of SIGQUIT signal\n");
+    flushOutput();
+    exit(1);
+}
+
+
+